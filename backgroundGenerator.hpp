@@ -0,0 +1,148 @@
+#pragma once
+
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <condition_variable>
+
+#include "dungeonGenerator.hpp"
+#include "generatorStats.hpp"
+
+// Generate dungeons on a worker thread so the caller never waits.
+// A request cancels the generation running, if any, and the worker moves on to the newest
+// parameters. Results are written in a back buffer and swapped with the front one when
+// complete, poll() hands over the latest one.
+class BackgroundGenerator
+{
+public:
+    BackgroundGenerator() : worker([this]{run();})
+    {
+    }
+
+    ~BackgroundGenerator()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            progress.cancel = true;
+        }
+
+        wake.notify_one();
+        worker.join();
+    }
+
+    BackgroundGenerator(const BackgroundGenerator&) = delete;
+    BackgroundGenerator& operator=(const BackgroundGenerator&) = delete;
+
+    // generate the dungeon described by parameters, replacing any pending request
+    void request(const Dungeon& parameters)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending = parameters;
+            hasPending = true;
+            progress.cancel = true;
+        }
+
+        wake.notify_one();
+    }
+
+    // If a dungeon was completed since the last call swap it into dungeon and return true.
+    // The rooms, corridors, edges and tiles are replaced, the parameters are the ones it was generated with
+    bool poll(Dungeon& dungeon, GeneratorStats* stats = nullptr)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(!hasResult)
+            return false;
+
+        std::swap(dungeon, front);
+        if(stats)
+            *stats = frontStats;
+
+        hasResult = false;
+        return true;
+    }
+
+    // true from a request until its dungeon is complete or replaced by another request
+    bool isBusy() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return hasPending || running;
+    }
+
+    GeneratorStats::Stage getStage() const
+    {
+        return static_cast<GeneratorStats::Stage>(progress.stage.load());
+    }
+
+    float getStageProgress() const
+    {
+        return progress.stageProgress;
+    }
+
+private:
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while(true)
+        {
+            wake.wait(lock, [this]{return hasPending || stopping;});
+            if(stopping)
+                return;
+
+            back = std::move(pending);
+            hasPending = false;
+            running = true;
+            progress.cancel = false;
+
+            lock.unlock();
+            const auto result = generator.generate(back, &progress);
+            lock.lock();
+
+            running = false;
+
+            // UNCHANGED keeps the results of the run before, cancelled or rejected there are none
+            if(result == GenerationResult::GENERATED)
+            {
+                delivered = false;
+                resultStats = generator.getStats();
+            }
+            else if(result != GenerationResult::UNCHANGED)
+                delivered = true;
+
+            // A request came in meanwhile, the result is stale or incomplete. If the request
+            // is for the same parameters its run is UNCHANGED and hands over this result then
+            if(hasPending || stopping || delivered)
+                continue;
+
+            if(result == GenerationResult::UNCHANGED)
+                generator.copyResults(back);
+
+            std::swap(back, front);
+            frontStats = resultStats;
+            hasResult = true;
+            delivered = true;
+        }
+    }
+
+    DungeonGenerator generator;
+    GenerationProgress progress;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+
+    Dungeon pending;
+    Dungeon back;
+    Dungeon front;
+    GeneratorStats frontStats;
+    GeneratorStats resultStats; // of the run that generated the results in the generator
+
+    bool hasPending = false;
+    bool hasResult = false;
+    bool delivered = true; // the results in the generator were handed over, or there are none
+    bool running = false;
+    bool stopping = false;
+
+    std::thread worker;
+};
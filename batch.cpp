@@ -0,0 +1,347 @@
+// Headless batch generation, generate a range of seeds on every core
+// and stream the dungeons as JSON lines, in seed order.
+
+#include "tilemap.hpp"
+#include "dungeonGenerator.hpp"
+#include "threadPool.hpp"
+#include "dungeonFile.hpp"
+
+#include <map>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    struct Options
+    {
+        Dungeon dungeon;
+
+        int firstSeed = 0;
+        int seedCount = 1000;
+
+        int threads = 0;
+        int grain = 16;
+
+        bool summary = false;
+        bool parallelPlacement = false;
+        const char* output = nullptr;
+        const char* bake = nullptr;
+    };
+
+    void printUsage()
+    {
+        std::cerr <<
+            "usage: batch [options]\n"
+            "  --seeds FIRST:COUNT           seeds to generate (0:1000)\n"
+            "  --threads N                   worker threads, 0 for one per core (0)\n"
+            "  --grain N                     seeds per task (16)\n"
+            "  --size WxH                    map size\n"
+            "  --room-size MIN:MAX           room size range\n"
+            "  --pool N                      room pool size\n"
+            "  --distance N                  minimal room distance\n"
+            "  --directional-distance N      minimal directional room distance\n"
+            "  --additional-edges N          corridors added to the spanning tree\n"
+            "  --door-corner N               minimal distance from a door to a corner\n"
+            "  --min-rooms N                 reject the dungeons with fewer rooms\n"
+            "  --min-coverage F              reject the dungeons with less of the map in rooms, from 0 to 1\n"
+            "  --min-loops N                 reject the dungeons with fewer edges beyond the spanning tree\n"
+            "  --diameter MIN:MAX            reject the dungeons whose diameter in rooms is out of range, 0 for no bound\n"
+            "  --no-room-crossings           reject the dungeons with a corridor running through a room it doesn't join\n"
+            "  --prim                        build the spanning tree with Prim\n"
+            "  --exhaustive                  test every position when placing the rooms\n"
+            "  --parallel-placement          generate the seeds one at a time, each placement on every thread\n"
+            "  --summary                     only output the counts of each dungeon\n"
+            "  --output FILE                 write to FILE instead of stdout\n"
+            "  --bake DIR                    also write every dungeon to DIR/SEED.dgnb\n";
+    }
+
+    bool parsePair(const char* text, char separator, int& first, int& second)
+    {
+        char* end;
+        first = std::strtol(text, &end, 10);
+        if(*end != separator)
+            return false;
+
+        second = std::strtol(end + 1, &end, 10);
+        return *end == '\0';
+    }
+
+    bool parseInt(const char* text, int& value)
+    {
+        char* end;
+        value = std::strtol(text, &end, 10);
+        return *text && *end == '\0';
+    }
+
+    bool parseFloat(const char* text, float& value)
+    {
+        char* end;
+        value = std::strtof(text, &end);
+        return *text && *end == '\0';
+    }
+
+    bool parseOptions(int argc, char** argv, Options& options)
+    {
+        auto& dungeon = options.dungeon;
+
+        for(int x = 1; x < argc; x++)
+        {
+            const char* name = argv[x];
+
+            if(!std::strcmp(name, "--summary"))
+            {
+                options.summary = true;
+                continue;
+            }
+
+            if(!std::strcmp(name, "--parallel-placement"))
+            {
+                options.parallelPlacement = true;
+                continue;
+            }
+
+            if(!std::strcmp(name, "--prim"))
+            {
+                dungeon.spanningTree = Dungeon::PRIM;
+                continue;
+            }
+
+            if(!std::strcmp(name, "--exhaustive"))
+            {
+                dungeon.placement = Dungeon::EXHAUSTIVE;
+                continue;
+            }
+
+            if(!std::strcmp(name, "--no-room-crossings"))
+            {
+                dungeon.acceptance.noRoomCrossings = true;
+                continue;
+            }
+
+            if(x + 1 == argc)
+                return false;
+
+            const char* value = argv[++x];
+
+            bool valid;
+            if(!std::strcmp(name, "--seeds"))
+                valid = parsePair(value, ':', options.firstSeed, options.seedCount);
+            else if(!std::strcmp(name, "--threads"))
+                valid = parseInt(value, options.threads);
+            else if(!std::strcmp(name, "--grain"))
+                valid = parseInt(value, options.grain);
+            else if(!std::strcmp(name, "--size"))
+                valid = parsePair(value, 'x', dungeon.size.x, dungeon.size.y);
+            else if(!std::strcmp(name, "--room-size"))
+                valid = parsePair(value, ':', dungeon.roomSizeMin, dungeon.roomSizeMax);
+            else if(!std::strcmp(name, "--pool"))
+                valid = parseInt(value, dungeon.roomPoolSize);
+            else if(!std::strcmp(name, "--distance"))
+                valid = parseInt(value, dungeon.minimalRoomDistance);
+            else if(!std::strcmp(name, "--directional-distance"))
+                valid = parseInt(value, dungeon.minimalDirectionalRoomDistance);
+            else if(!std::strcmp(name, "--additional-edges"))
+                valid = parseInt(value, dungeon.additionalEdge);
+            else if(!std::strcmp(name, "--door-corner"))
+                valid = parseInt(value, dungeon.minDoorDistToCorner);
+            else if(!std::strcmp(name, "--min-rooms"))
+                valid = parseInt(value, dungeon.acceptance.minRooms);
+            else if(!std::strcmp(name, "--min-coverage"))
+                valid = parseFloat(value, dungeon.acceptance.minCoverage);
+            else if(!std::strcmp(name, "--min-loops"))
+                valid = parseInt(value, dungeon.acceptance.minLoops);
+            else if(!std::strcmp(name, "--diameter"))
+                valid = parsePair(value, ':', dungeon.acceptance.minDiameter, dungeon.acceptance.maxDiameter);
+            else if(!std::strcmp(name, "--output"))
+                valid = (options.output = value) != nullptr;
+            else if(!std::strcmp(name, "--bake"))
+                valid = (options.bake = value) != nullptr;
+            else
+                valid = false;
+
+            if(!valid)
+                return false;
+        }
+
+        return options.seedCount >= 0 && dungeon.roomSizeMin <= dungeon.roomSizeMax;
+    }
+
+    void appendVector(std::string& text, const Vec2i& v)
+    {
+        text += std::to_string(v.x);
+        text += ',';
+        text += std::to_string(v.y);
+    }
+
+    std::string toJson(const Dungeon& dungeon, bool summary)
+    {
+        std::string text = "{\"seed\":" + std::to_string(dungeon.seed);
+
+        if(summary)
+        {
+            text += ",\"rooms\":" + std::to_string(dungeon.rooms.size());
+            text += ",\"corridors\":" + std::to_string(dungeon.corridors.size());
+            text += ",\"edges\":" + std::to_string(dungeon.edges.size());
+            text += "}\n";
+            return text;
+        }
+
+        text += ",\"rooms\":[";
+        for(const auto& room : dungeon.rooms)
+        {
+            text += &room == &dungeon.rooms.front() ? "[" : ",[";
+            appendVector(text, room.pos);
+            text += ',';
+            appendVector(text, room.size);
+            text += ']';
+        }
+
+        text += "],\"corridors\":[";
+        for(const auto& corridor : dungeon.corridors)
+        {
+            text += &corridor == &dungeon.corridors.front() ? "[" : ",[";
+            appendVector(text, corridor.start);
+            text += ',';
+            appendVector(text, corridor.end);
+            text += ']';
+        }
+
+        text += "],\"edges\":[";
+        for(const auto& edge : dungeon.edges)
+        {
+            text += &edge == &dungeon.edges.front() ? "[" : ",[";
+            appendVector(text, edge.p1);
+            text += ',';
+            appendVector(text, edge.p2);
+            text += ']';
+        }
+
+        text += "]}\n";
+        return text;
+    }
+
+    // Keep the results finished out of order until every seed before them is written
+    class OrderedWriter
+    {
+    public:
+        explicit OrderedWriter(std::ostream& out) : out(out)
+        {
+        }
+
+        void write(int index, std::string text)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            pending.emplace(index, std::move(text));
+
+            for(auto it = pending.begin(); it != pending.end() && it->first == next; it = pending.erase(it))
+            {
+                out << it->second;
+                next++;
+            }
+        }
+
+    private:
+        std::ostream& out;
+
+        std::mutex mutex;
+        std::map<int, std::string> pending;
+        int next = 0;
+    };
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if(!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    std::ofstream file;
+    if(options.output)
+    {
+        file.open(options.output, std::ios::binary);
+        if(!file)
+        {
+            std::cerr << "can't open " << options.output << '\n';
+            return 1;
+        }
+    }
+
+    std::ostream& out = options.output ? file : std::cout;
+    std::ios::sync_with_stdio(false);
+
+    OrderedWriter writer(out);
+    std::atomic<bool> bakeFailed(false);
+    ThreadPool pool(options.threads);
+
+    // a generator per thread, their memory is reused from one seed to the next
+    std::vector<std::unique_ptr<DungeonGenerator>> generators(pool.size() + 1);
+
+    auto generate = [&](int index)
+    {
+        auto& generator = generators[pool.workerIndex() + 1];
+        if(!generator)
+        {
+            generator.reset(new DungeonGenerator);
+            if(options.parallelPlacement)
+                generator->setThreadPool(&pool);
+        }
+
+        Dungeon dungeon = options.dungeon;
+        dungeon.seed = options.firstSeed + index;
+
+        // rejected seeds are left out, the ones after them still wait for their turn
+        if(generator->generate(dungeon) == GenerationResult::REJECTED)
+        {
+            writer.write(index, {});
+            return;
+        }
+
+        if(options.bake)
+        {
+            const std::string path = std::string(options.bake) + "/" + std::to_string(dungeon.seed) + ".dgnb";
+            if(!writeDungeon(path.c_str(), dungeon, generator->getMap()))
+                bakeFailed = true;
+        }
+
+        writer.write(index, toJson(dungeon, options.summary));
+    };
+
+    // with the placement spread over the pool the seeds are generated in turn on this thread
+    if(options.parallelPlacement)
+    {
+        for(int index = 0; index < options.seedCount; index++)
+            generate(index);
+    }
+    else
+        pool.parallelFor(0, options.seedCount, generate, options.grain);
+
+    out.flush();
+
+    if(options.dungeon.acceptance.isEnabled())
+    {
+        RejectionStats rejections;
+        for(const auto& generator : generators)
+        {
+            if(generator)
+                rejections.add(generator->getRejectionStats());
+        }
+
+        std::cerr << "rejections: " << rejections.toJson() << '\n';
+    }
+
+    if(bakeFailed)
+        std::cerr << "can't write the dungeons in " << options.bake << '\n';
+
+    return out && !bakeFailed ? 0 : 1;
+}
@@ -0,0 +1,603 @@
+// Benchmark of the generator over a sweep of parameters with fixed seeds.
+// Every configuration times the whole generation, in batches too, and the triangulation, spanning
+// tree and tile kernels on their own, and writes one JSON line per measure. Given the output of a previous
+// run with --compare it reports the measures that got slower than the tolerance allows.
+// Built with -DDUNGEON_STATS=1 it times every stage of the generator instead, the instrumentation
+// slows it down so that build only writes the stage times, under their own benchmark name.
+
+#include "dungeonGenerator.hpp"
+#include "dungeonBatch.hpp"
+#include "dungeonPreset.hpp"
+
+#include <map>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    struct Config
+    {
+        Vec2i size;
+        int pool;
+        int roomSizeMin;
+        int roomSizeMax;
+        int additionalEdge;
+
+        std::string getName() const
+        {
+            return std::to_string(size.x) + "x" + std::to_string(size.y) +
+                "/pool" + std::to_string(pool) +
+                "/room" + std::to_string(roomSizeMin) + "-" + std::to_string(roomSizeMax) +
+                "/edges" + std::to_string(additionalEdge);
+        }
+    };
+
+    struct Options
+    {
+        std::vector<Vec2i> sizes = {{50, 50}, {100, 100}, {200, 200}};
+        std::vector<int> pools = {25, 50, 100};
+        std::vector<std::pair<int, int>> roomSizes = {{3, 6}, {4, 10}};
+        std::vector<int> additionalEdges = {0, 3};
+
+        int firstSeed = 0;
+        int seedCount = 20;
+        int repeat = 3;
+
+        const char* output = nullptr;
+        const char* compare = nullptr;
+        double tolerance = 0.1;
+    };
+
+    // A benchmark of one configuration, times are the ones of the fastest pass over the seeds
+    struct Measure
+    {
+        std::string config;
+        std::string benchmark;
+
+        int dungeons = 0;
+        long long rooms = 0;
+        double seconds = 0;
+
+        GeneratorStats stages;
+        bool hasStages = false;
+
+        std::string getKey() const
+        {
+            return config + " " + benchmark;
+        }
+
+        double getNsPerDungeon() const
+        {
+            return dungeons ? seconds * 1e9 / dungeons : 0;
+        }
+    };
+
+    void printUsage()
+    {
+        std::cerr <<
+            "usage: bench [options]\n"
+            "  --seeds FIRST:COUNT           seeds generated for every configuration (0:20)\n"
+            "  --repeat N                    passes over the seeds, the fastest is kept (3)\n"
+            "  --sizes WxH,...               map sizes (50x50,100x100,200x200)\n"
+            "  --pools N,...                 room pool sizes (25,50,100)\n"
+            "  --room-sizes MIN:MAX,...      room size ranges (3:6,4:10)\n"
+            "  --additional-edges N,...      corridors added to the spanning tree (0,3)\n"
+            "  --output FILE                 write to FILE instead of stdout\n"
+            "  --compare FILE                compare with the output of a previous run\n"
+            "  --tolerance T                 slowdown allowed by --compare (0.1 for 10%)\n";
+    }
+
+    bool parsePair(const char* text, char separator, int& first, int& second)
+    {
+        char* end;
+        first = std::strtol(text, &end, 10);
+        if(*end != separator)
+            return false;
+
+        second = std::strtol(end + 1, &end, 10);
+        return *end == '\0';
+    }
+
+    bool parseInt(const char* text, int& value)
+    {
+        char* end;
+        value = std::strtol(text, &end, 10);
+        return *text && *end == '\0';
+    }
+
+    // split a comma separated list and parse every item
+    template <typename T, typename Parse>
+    bool parseList(const char* text, std::vector<T>& list, Parse parse)
+    {
+        list.clear();
+
+        std::string items = text;
+        std::size_t start = 0;
+        while(start <= items.size())
+        {
+            std::size_t end = items.find(',', start);
+            if(end == std::string::npos)
+                end = items.size();
+
+            T value;
+            if(!parse(items.substr(start, end - start).c_str(), value))
+                return false;
+
+            list.push_back(value);
+            start = end + 1;
+        }
+
+        return !list.empty();
+    }
+
+    bool parseOptions(int argc, char** argv, Options& options)
+    {
+        for(int x = 1; x < argc; x++)
+        {
+            const char* name = argv[x];
+
+            if(x + 1 == argc)
+                return false;
+
+            const char* value = argv[++x];
+
+            bool valid;
+            if(!std::strcmp(name, "--seeds"))
+                valid = parsePair(value, ':', options.firstSeed, options.seedCount);
+            else if(!std::strcmp(name, "--repeat"))
+                valid = parseInt(value, options.repeat);
+            else if(!std::strcmp(name, "--sizes"))
+                valid = parseList(value, options.sizes, [](const char* item, Vec2i& size) {return parsePair(item, 'x', size.x, size.y);});
+            else if(!std::strcmp(name, "--pools"))
+                valid = parseList(value, options.pools, parseInt);
+            else if(!std::strcmp(name, "--room-sizes"))
+                valid = parseList(value, options.roomSizes, [](const char* item, std::pair<int, int>& range) {return parsePair(item, ':', range.first, range.second) && range.first <= range.second;});
+            else if(!std::strcmp(name, "--additional-edges"))
+                valid = parseList(value, options.additionalEdges, parseInt);
+            else if(!std::strcmp(name, "--output"))
+                valid = (options.output = value) != nullptr;
+            else if(!std::strcmp(name, "--compare"))
+                valid = (options.compare = value) != nullptr;
+            else if(!std::strcmp(name, "--tolerance"))
+                valid = std::sscanf(value, "%lf", &options.tolerance) == 1;
+            else
+                valid = false;
+
+            if(!valid)
+                return false;
+        }
+
+        return options.seedCount > 0 && options.repeat > 0;
+    }
+
+    std::string formatNumber(double value)
+    {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.6g", value);
+        return text;
+    }
+
+    std::string toJson(const Measure& measure)
+    {
+        std::string text = "{\"config\":\"" + measure.config + "\",\"benchmark\":\"" + measure.benchmark + "\"";
+        text += ",\"dungeons\":" + std::to_string(measure.dungeons);
+        text += ",\"rooms\":" + std::to_string(measure.rooms);
+        text += ",\"seconds\":" + formatNumber(measure.seconds);
+        text += ",\"dungeonsPerSec\":" + formatNumber(measure.seconds > 0 ? measure.dungeons / measure.seconds : 0);
+        text += ",\"nsPerDungeon\":" + formatNumber(measure.getNsPerDungeon());
+        text += ",\"nsPerRoom\":" + formatNumber(measure.rooms ? measure.seconds * 1e9 / measure.rooms : 0);
+
+        if(measure.hasStages)
+        {
+            text += ",\"stageNsPerDungeon\":{";
+            for(int stage = 0; stage < GeneratorStats::STAGE_COUNT; stage++)
+            {
+                text += stage ? ",\"" : "\"";
+                text += GeneratorStats::getStageName(stage);
+                text += "\":" + formatNumber(measure.stages.stageTime[stage] * 1e6 / measure.dungeons);
+            }
+            text += "}";
+        }
+
+        text += "}\n";
+        return text;
+    }
+
+    // only reads back what toJson writes
+    bool readField(const std::string& line, const char* name, std::string& value)
+    {
+        const std::string pattern = std::string("\"") + name + "\":";
+        std::size_t start = line.find(pattern);
+        if(start == std::string::npos)
+            return false;
+
+        start += pattern.size();
+        if(line[start] == '"')
+        {
+            const std::size_t end = line.find('"', start + 1);
+            value = line.substr(start + 1, end - start - 1);
+        }
+        else
+        {
+            const std::size_t end = line.find_first_of(",}", start);
+            value = line.substr(start, end - start);
+        }
+
+        return true;
+    }
+
+    template <typename Function>
+    double timePass(Function function)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // run the passes and keep the fastest one
+    template <typename Function>
+    void measure(Measure& result, int repeat, Function pass)
+    {
+        result.seconds = 0;
+        for(int x = 0; x < repeat; x++)
+        {
+            const double seconds = timePass(pass);
+            if(x == 0 || seconds < result.seconds)
+                result.seconds = seconds;
+        }
+    }
+
+    Dungeon makeDungeon(const Config& config)
+    {
+        Dungeon dungeon;
+        dungeon.size = config.size;
+        dungeon.roomPoolSize = config.pool;
+        dungeon.roomSizeMin = config.roomSizeMin;
+        dungeon.roomSizeMax = config.roomSizeMax;
+        dungeon.additionalEdge = config.additionalEdge;
+        return dungeon;
+    }
+
+    // The preset generator over the seeds if Preset has the parameters of dungeon, false if it hasn't
+    template <typename Preset>
+    bool measurePreset(const Dungeon& dungeon, const Options& options, Measure& result)
+    {
+        const Dungeon preset = Preset::make(0);
+        if(preset.size != dungeon.size || preset.roomSizeMin != dungeon.roomSizeMin || preset.roomSizeMax != dungeon.roomSizeMax ||
+            preset.roomPoolSize != dungeon.roomPoolSize || preset.additionalEdge != dungeon.additionalEdge)
+            return false;
+
+        // too big for the stack
+        auto generator = std::make_unique<PresetGenerator<Preset>>();
+        measure(result, options.repeat, [&]
+        {
+            for(int x = 0; x < options.seedCount; x++)
+                generator->generate(options.firstSeed + x);
+        });
+
+        return true;
+    }
+
+    void runConfig(const Config& config, const Options& options, std::vector<Measure>& measures)
+    {
+        Dungeon dungeon = makeDungeon(config);
+
+        const std::string name = config.getName();
+
+        // room centers of every seed, the input of the triangulation benchmarks, and the maps
+        // carved, the input of the tile kernels
+        std::vector<std::vector<Vec2i>> points(options.seedCount);
+        std::vector<std::vector<std::pair<int, int>>> edges(options.seedCount);
+        std::vector<TileMap<bool>> maps(options.seedCount);
+        long long rooms = 0;
+
+        {
+            DungeonGenerator generator;
+            Triangulator triangulator;
+            for(int x = 0; x < options.seedCount; x++)
+            {
+                dungeon.seed = options.firstSeed + x;
+                generator.generate(dungeon);
+                maps[x] = generator.getMap();
+
+                for(const auto& room : dungeon.rooms)
+                    points[x].push_back(room.pos + room.size/2);
+
+                triangulator.triangulate(points[x]);
+                edges[x].assign(triangulator.getEdges().begin(), triangulator.getEdges().end());
+
+                rooms += dungeon.rooms.size();
+            }
+        }
+
+        auto makeMeasure = [&](const char* benchmark)
+        {
+            Measure result;
+            result.config = name;
+            result.benchmark = benchmark;
+            result.dungeons = options.seedCount;
+            result.rooms = rooms;
+            return result;
+        };
+
+        // a new generator for every dungeon, memory included
+        Measure cold = makeMeasure("generateDungeon");
+        measure(cold, options.repeat, [&]
+        {
+            for(int x = 0; x < options.seedCount; x++)
+            {
+                dungeon.seed = options.firstSeed + x;
+                generateDungeon(dungeon);
+            }
+        });
+        measures.push_back(cold);
+
+        // the same generator for every dungeon
+        Measure warm = makeMeasure("generator");
+        {
+            DungeonGenerator generator;
+            measure(warm, options.repeat, [&]
+            {
+                for(int x = 0; x < options.seedCount; x++)
+                {
+                    dungeon.seed = options.firstSeed + x;
+                    generator.generate(dungeon);
+                }
+            });
+        }
+        measures.push_back(warm);
+
+        // the configurations of the default sweep with a preset instantiated for them
+        Measure preset = makeMeasure("presetGenerator");
+        if(
+            measurePreset<DefaultDungeonPreset>(dungeon, options, preset) ||
+            measurePreset<DungeonPreset<100, 100>>(dungeon, options, preset) ||
+            measurePreset<DungeonPreset<200, 200>>(dungeon, options, preset))
+            measures.push_back(preset);
+
+        // straight into flat arrays, without a Dungeon per seed
+        Measure batched = makeMeasure("batch");
+        {
+            BatchGenerator generator;
+            DungeonBatch batch;
+
+            measure(batched, options.repeat, [&]
+            {
+                batch.clear();
+                generator.generate(dungeon, options.firstSeed, options.seedCount, batch);
+            });
+        }
+        measures.push_back(batched);
+
+        Measure triangulation = makeMeasure("triangulate");
+        {
+            Triangulator triangulator;
+            measure(triangulation, options.repeat, [&]
+            {
+                for(const auto& roomPoints : points)
+                    triangulator.triangulate(roomPoints);
+            });
+        }
+        measures.push_back(triangulation);
+
+        ScratchArena arena(std::pmr::new_delete_resource());
+
+        Measure kruskal = makeMeasure("minimumSpanningTree");
+        measure(kruskal, options.repeat, [&]
+        {
+            for(int x = 0; x < options.seedCount; x++)
+            {
+                arena.reset();
+                minimumSpanningTree(points[x], edges[x], &arena);
+            }
+        });
+        measures.push_back(kruskal);
+
+        Measure prim = makeMeasure("primSpanningTree");
+        measure(prim, options.repeat, [&]
+        {
+            for(int x = 0; x < options.seedCount; x++)
+            {
+                arena.reset();
+                primSpanningTree(points[x], edges[x], &arena);
+            }
+        });
+        measures.push_back(prim);
+
+        // the spans of every row, how the tiles are built from the map, with the kernel picked
+        volatile std::size_t sink = 0;
+
+        Measure spans = makeMeasure("tileSpans");
+        measure(spans, options.repeat, [&]
+        {
+            std::size_t count = 0;
+            for(const auto& map : maps)
+            {
+                for(int y = 0; y < map.getSize().y; y++)
+                    map.forEachSpan(y, [&](int, int){count++;});
+            }
+
+            sink = count;
+        });
+        measures.push_back(spans);
+
+        // every kernel the cpu runs over the rows of the maps, skipping the empty words
+        for(const auto& kernel : tileKernels::getKernels())
+        {
+            Measure find = makeMeasure((std::string("findDifferent/") + kernel.name).c_str());
+            measure(find, options.repeat, [&]
+            {
+                std::size_t found = 0;
+                for(const auto& map : maps)
+                {
+                    for(int y = 0; y < map.getSize().y; y++)
+                        found += kernel.find(reinterpret_cast<const std::uint8_t*>(map.row(y)), map.getStride() * sizeof(TileMap<bool>::Word), 0);
+                }
+
+                sink = found;
+            });
+            measures.push_back(find);
+        }
+    }
+
+    // The generator reusing its memory with the time of every stage, the ones of the fastest pass.
+    // Only run by the build with DUNGEON_STATS, the times are the ones of the instrumented generator
+    void runStages(const Config& config, const Options& options, std::vector<Measure>& measures)
+    {
+        Dungeon dungeon = makeDungeon(config);
+
+        Measure staged;
+        staged.config = config.getName();
+        staged.benchmark = "generatorStages";
+        staged.dungeons = options.seedCount;
+        staged.hasStages = true;
+
+        DungeonGenerator generator;
+        GeneratorStats total;
+
+        measure(staged, options.repeat + 1, [&]
+        {
+            GeneratorStats pass;
+            long long rooms = 0;
+
+            for(int x = 0; x < options.seedCount; x++)
+            {
+                dungeon.seed = options.firstSeed + x;
+                generator.generate(dungeon);
+                rooms += dungeon.rooms.size();
+
+                for(int stage = 0; stage < GeneratorStats::STAGE_COUNT; stage++)
+                    pass.stageTime[stage] += generator.getStats().stageTime[stage];
+                pass.totalTime += generator.getStats().totalTime;
+            }
+
+            if(total.totalTime == 0 || pass.totalTime < total.totalTime)
+                total = pass;
+
+            staged.rooms = rooms;
+        });
+
+        staged.stages = total;
+        measures.push_back(staged);
+    }
+
+    // Return the number of measures slower than the baseline by more than the tolerance
+    int compare(const std::vector<Measure>& measures, const char* path, double tolerance)
+    {
+        std::ifstream file(path);
+        if(!file)
+        {
+            std::cerr << "can't open " << path << '\n';
+            return -1;
+        }
+
+        struct Baseline
+        {
+            double nsPerDungeon;
+            long long rooms;
+        };
+
+        std::map<std::string, Baseline> baselines;
+
+        std::string line;
+        while(std::getline(file, line))
+        {
+            std::string config, benchmark, ns, rooms;
+            if(readField(line, "config", config) && readField(line, "benchmark", benchmark) && readField(line, "nsPerDungeon", ns) && readField(line, "rooms", rooms))
+                baselines[config + " " + benchmark] = {std::atof(ns.c_str()), std::atoll(rooms.c_str())};
+        }
+
+        int regressions = 0;
+        for(const auto& measure : measures)
+        {
+            const auto it = baselines.find(measure.getKey());
+            if(it == baselines.end())
+            {
+                std::cerr << "new      " << measure.getKey() << '\n';
+                continue;
+            }
+
+            // different dungeons, the times can't be compared
+            if(it->second.rooms != measure.rooms)
+                std::cerr << "changed  " << measure.getKey() << " rooms " << it->second.rooms << " -> " << measure.rooms << '\n';
+
+            const double ratio = it->second.nsPerDungeon > 0 ? measure.getNsPerDungeon() / it->second.nsPerDungeon : 1;
+            const bool slower = ratio > 1 + tolerance;
+            regressions += slower;
+
+            char text[256];
+            std::snprintf(text, sizeof(text), "%s %-60s %12.0f -> %12.0f ns/dungeon (%+.1f%%)\n",
+                slower ? "SLOWER  " : ratio < 1 - tolerance ? "faster  " : "same    ",
+                measure.getKey().c_str(), it->second.nsPerDungeon, measure.getNsPerDungeon(), (ratio - 1) * 100);
+            std::cerr << text;
+        }
+
+        return regressions;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if(!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    std::ofstream file;
+    if(options.output)
+    {
+        file.open(options.output, std::ios::binary);
+        if(!file)
+        {
+            std::cerr << "can't open " << options.output << '\n';
+            return 1;
+        }
+    }
+
+    std::ostream& out = options.output ? file : std::cout;
+
+    std::vector<Measure> measures;
+    for(const auto& size : options.sizes)
+    {
+        for(int pool : options.pools)
+        {
+            for(const auto& roomSize : options.roomSizes)
+            {
+                for(int additionalEdge : options.additionalEdges)
+                {
+                    const std::size_t first = measures.size();
+                    const Config config = {size, pool, roomSize.first, roomSize.second, additionalEdge};
+                    if(DUNGEON_STATS)
+                        runStages(config, options, measures);
+                    else
+                        runConfig(config, options, measures);
+
+                    for(std::size_t x = first; x < measures.size(); x++)
+                        out << toJson(measures[x]);
+                    out.flush();
+                }
+            }
+        }
+    }
+
+    if(options.compare)
+    {
+        const int regressions = compare(measures, options.compare, options.tolerance);
+        if(regressions < 0)
+            return 1;
+
+        std::cerr << regressions << " regression(s)\n";
+        return regressions ? 2 : 0;
+    }
+
+    return out ? 0 : 1;
+}
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+#include "vector2.hpp"
+#include "tilemap.hpp"
+#include "random.hpp"
+#include "dungeonGenerator.hpp"
+
+// A piece of a chunked world, coordinates are local to the chunk, origin is its top left tile in the world
+struct WorldChunk
+{
+    Vec2i coord;
+    Vec2i origin;
+
+    std::vector<Dungeon::Room> rooms;
+    std::vector<Dungeon::Corridor> corridors;
+    std::vector<Edge> edges;
+
+    // tiles on the border of the chunk leading to its neighbours, indexed by Dungeon::Room::Side
+    std::array<Vec2i, 4> portals = {};
+
+    TileMap<bool> map;
+};
+
+// Unbounded world split in chunks of chunkSize x chunkSize tiles.
+// Every chunk is a dungeon generated from a seed hashed from the world seed and its coordinate,
+// so it can be generated alone, in any order, and is always the same.
+// Two neighbouring chunks share a portal on their common border, placed from a hash of the border,
+// and each of them carves a corridor from its side of the portal to its closest room, which
+// stitches the corridors of the chunks together.
+//
+// Only the chunks around the view are kept, setView() loads the missing ones and evicts
+// the others, calling the callbacks for each of them.
+class ChunkedWorld
+{
+public:
+    using Callback = std::function<void(const WorldChunk&)>;
+
+    // settings are the parameters of every chunk, their size and seed are replaced.
+    // Seed -1 picks a random world
+    ChunkedWorld(const Dungeon& settings, int chunkSize) : settings(settings), chunkSize(chunkSize)
+    {
+        worldSeed = settings.seed == -1 ? systemSeed() : settings.seed;
+
+        this->settings.size = {chunkSize, chunkSize};
+    }
+
+    ChunkedWorld(const ChunkedWorld&) = delete;
+    ChunkedWorld& operator=(const ChunkedWorld&) = delete;
+
+    void setLoadCallback(Callback callback)
+    {
+        onLoad = std::move(callback);
+    }
+
+    void setEvictCallback(Callback callback)
+    {
+        onEvict = std::move(callback);
+    }
+
+    int getChunkSize() const
+    {
+        return chunkSize;
+    }
+
+    // chunk containing a world tile
+    Vec2i toChunk(const Vec2i& pos) const
+    {
+        return {floorDiv(pos.x, chunkSize), floorDiv(pos.y, chunkSize)};
+    }
+
+    // Keep the chunks at most radius chunks away from center on both axis, load the missing ones and evict the others
+    void setView(const Vec2i& center, int radius)
+    {
+        for(auto it = chunks.begin(); it != chunks.end();)
+        {
+            const auto delta = it->first - center;
+            if(std::abs(delta.x) <= radius && std::abs(delta.y) <= radius)
+            {
+                ++it;
+                continue;
+            }
+
+            if(onEvict)
+                onEvict(it->second);
+
+            it = chunks.erase(it);
+        }
+
+        for(int y = center.y - radius; y <= center.y + radius; y++)
+        {
+            for(int x = center.x - radius; x <= center.x + radius; x++)
+                getChunk({x, y});
+        }
+    }
+
+    // the chunk at coord, generated and loaded if it wasn't
+    const WorldChunk& getChunk(const Vec2i& coord)
+    {
+        auto it = chunks.find(coord);
+        if(it != chunks.end())
+            return it->second;
+
+        auto& chunk = chunks[coord];
+        generateChunk(coord, chunk);
+
+        if(onLoad)
+            onLoad(chunk);
+
+        return chunk;
+    }
+
+    const std::unordered_map<Vec2i, WorldChunk>& getChunks() const
+    {
+        return chunks;
+    }
+
+    // Generate a chunk without keeping it, to stream the world through chunks that are never loaded.
+    // A chunk rejected by the acceptance criteria of the settings is generated again from other
+    // seeds, after maxAttempts it's left without rooms and its portals meet in its middle
+    void generateChunk(const Vec2i& coord, WorldChunk& chunk)
+    {
+        Dungeon dungeon = settings;
+
+        auto result = GenerationResult::REJECTED;
+        for(int attempt = 0; attempt < maxAttempts && result == GenerationResult::REJECTED; attempt++)
+        {
+            dungeon.seed = hash(coord.x, coord.y, attempt ? retrySalt + attempt : 0) & 0x7fffffff;
+            result = generator.run(dungeon);
+        }
+
+        chunk.coord = coord;
+        chunk.origin = coord * chunkSize;
+
+        chunk.rooms.clear();
+        chunk.corridors.clear();
+        chunk.edges.clear();
+
+        // the results are read from the generator, they are there even when it had nothing to redo
+        if(result == GenerationResult::REJECTED)
+            chunk.map.setSize({chunkSize, chunkSize});
+        else
+        {
+            const auto& rooms = generator.getRooms();
+            chunk.rooms.assign(rooms.begin(), rooms.end());
+            chunk.corridors.assign(generator.getCorridors().begin(), generator.getCorridors().end());
+
+            for(const auto& edge : generator.getRoomEdges())
+                chunk.edges.push_back({rooms[edge.first].pos + rooms[edge.first].size/2, rooms[edge.second].pos + rooms[edge.second].size/2});
+
+            chunk.map = generator.getMap();
+        }
+
+        const int last = chunkSize - 1;
+
+        chunk.portals[Dungeon::Room::UP] = {portalOffset(coord.x, coord.y - 1, vertical), 0};
+        chunk.portals[Dungeon::Room::DOWN] = {portalOffset(coord.x, coord.y, vertical), last};
+        chunk.portals[Dungeon::Room::LEFT] = {0, portalOffset(coord.x - 1, coord.y, horizontal)};
+        chunk.portals[Dungeon::Room::RIGHT] = {last, portalOffset(coord.x, coord.y, horizontal)};
+
+        for(int side = Dungeon::Room::UP; side <= Dungeon::Room::RIGHT; side++)
+            connectPortal(chunk, chunk.portals[side], side == Dungeon::Room::UP || side == Dungeon::Room::DOWN);
+    }
+
+    // generations of a chunk before giving up on the acceptance criteria
+    static constexpr int maxAttempts = 8;
+
+private:
+    enum Border {horizontal = 1, vertical = 2};
+
+    // the seeds of the attempts after the first one, past the salts of the borders
+    static constexpr int retrySalt = vertical;
+
+    static int floorDiv(int value, int divisor)
+    {
+        return value / divisor - (value % divisor != 0 && (value < 0) != (divisor < 0));
+    }
+
+    std::uint64_t hash(int x, int y, int salt) const
+    {
+        return hashSeed(worldSeed, {std::uint32_t(x), std::uint32_t(y), std::uint32_t(salt)});
+    }
+
+    // Position of the portal along the border between chunk (x, y) and its right
+    // neighbour (horizontal) or the one below it (vertical), away from the corners
+    int portalOffset(int x, int y, Border border) const
+    {
+        const int margin = std::min(2, (chunkSize - 1) / 2);
+        return margin + hash(x, y, border) % std::max(chunkSize - margin * 2, 1);
+    }
+
+    // L shaped corridor from the portal, first away from its border, to the center of the closest room
+    void connectPortal(WorldChunk& chunk, const Vec2i& portal, bool fromTopOrBottom)
+    {
+        Vec2i target = {chunkSize / 2, chunkSize / 2};
+
+        // the index is empty when the chunk was rejected
+        const int room = generator.getIndex().nearestRoom(portal);
+        if(room != -1 && room < static_cast<int>(chunk.rooms.size()))
+            target = chunk.rooms[room].pos + chunk.rooms[room].size/2;
+
+        const Vec2i corner = fromTopOrBottom ? Vec2i(portal.x, target.y) : Vec2i(target.x, portal.y);
+
+        addCorridor(chunk, portal, corner);
+        addCorridor(chunk, corner, target);
+    }
+
+    static void addCorridor(WorldChunk& chunk, const Vec2i& from, const Vec2i& to)
+    {
+        const Vec2i start = {std::min(from.x, to.x), std::min(from.y, to.y)};
+        const Vec2i end = {std::max(from.x, to.x) + 1, std::max(from.y, to.y) + 1};
+
+        chunk.map.fillRect(start, end - start);
+        chunk.corridors.push_back({start, end});
+    }
+
+    Dungeon settings;
+    int chunkSize;
+    unsigned worldSeed;
+
+    DungeonGenerator generator;
+
+    std::unordered_map<Vec2i, WorldChunk> chunks;
+
+    Callback onLoad;
+    Callback onEvict;
+};
@@ -0,0 +1,441 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <memory_resource>
+
+#include "vector2.hpp"
+#include "generatorStats.hpp"
+
+// Incremental Delaunay triangulation (Bowyer-Watson) of integer points.
+//
+// Triangles know their neighbours, new points are located by walking from the
+// last created triangle and the cavity is grown through the adjacency instead
+// of testing every triangle. The convex hull is closed by "ghost" triangles
+// sharing a vertex at infinity, so there is no super triangle and every
+// predicate is evaluated exactly on the input coordinates.
+//
+// Scratch buffers are kept between calls, reuse the same Triangulator to
+// avoid reallocating when triangulating many point sets.
+struct Triangulator
+{
+    static constexpr int ghost = -1;
+
+    explicit Triangulator(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) :
+        triangles(resource), edges(resource), order(resource), alias(resource),
+        cavity(resource), pending(resource), newTriangles(resource), boundary(resource),
+        startLink(resource), endLink(resource), inMark(resource), outMark(resource)
+    {
+    }
+
+    // Triangulate points, duplicated points are merged into their first occurence
+    // and a fully collinear input degenerates into a chain along the line
+    template <typename Points>
+    void triangulate(const Points& points)
+    {
+        triangulate(points.data(), static_cast<int>(points.size()));
+    }
+
+    void triangulate(const Vec2i* points, int count)
+    {
+        pts = points;
+        pointCount = count;
+        triangles.clear();
+        edges.clear();
+
+        DUNGEON_STAT(trianglesCreated = trianglesDestroyed = 0);
+
+        if(count < 2)
+            return;
+
+        mergeDuplicates();
+
+        int a = -1, b = -1, c = -1;
+        for(int x = 0; x < count && c == -1; x++)
+        {
+            if(alias[x] != x)
+                continue;
+
+            if(a == -1)
+                a = x;
+            else if(b == -1)
+                b = x;
+            else if(orient(point(a), point(b), point(x)) != 0)
+                c = x;
+        }
+
+        if(b == -1)
+            return;
+
+        if(c == -1)
+        {
+            triangulateCollinear();
+            return;
+        }
+
+        if(orient(point(a), point(b), point(c)) < 0)
+            std::swap(b, c);
+
+        createFirstTriangle(a, b, c);
+
+        for(int x = 0; x < count; x++)
+        {
+            if(alias[x] != x || x == a || x == b || x == c)
+                continue;
+
+            insert(x);
+        }
+
+        collectEdges();
+    }
+
+    // Unique edges as indices in the triangulated points, first < second, sorted
+    const std::pmr::vector<std::pair<int, int>>& getEdges() const
+    {
+        return edges;
+    }
+
+    // Triangles, ghosts included, made and removed by the last call to triangulate.
+    // Only counted when DUNGEON_STATS is enabled
+    std::uint64_t getTrianglesCreated() const
+    {
+        return trianglesCreated;
+    }
+
+    std::uint64_t getTrianglesDestroyed() const
+    {
+        return trianglesDestroyed;
+    }
+
+    // > 0 if c is on the left of a->b, < 0 if on the right, 0 if collinear
+    static std::int64_t orient(const Vec2i& a, const Vec2i& b, const Vec2i& c)
+    {
+        return (std::int64_t(b.x) - a.x) * (std::int64_t(c.y) - a.y) - (std::int64_t(b.y) - a.y) * (std::int64_t(c.x) - a.x);
+    }
+
+    // > 0 if d is strictly inside the circumcircle of the counter clockwise triangle a, b, c
+    static int inCircle(const Vec2i& a, const Vec2i& b, const Vec2i& c, const Vec2i& d)
+    {
+#if defined(__SIZEOF_INT128__)
+        using Wide = __int128;
+#else
+        using Wide = long double;
+#endif
+        const Wide adx = std::int64_t(a.x) - d.x, ady = std::int64_t(a.y) - d.y;
+        const Wide bdx = std::int64_t(b.x) - d.x, bdy = std::int64_t(b.y) - d.y;
+        const Wide cdx = std::int64_t(c.x) - d.x, cdy = std::int64_t(c.y) - d.y;
+
+        const Wide det = (adx * adx + ady * ady) * (bdx * cdy - cdx * bdy)
+                       + (bdx * bdx + bdy * bdy) * (cdx * ady - adx * cdy)
+                       + (cdx * cdx + cdy * cdy) * (adx * bdy - bdx * ady);
+
+        return (det > 0) - (det < 0);
+    }
+
+private:
+    // Vertices are counter clockwise, n[i] is the neighbour across the edge
+    // opposite to v[i], going from v[i+1] to v[i+2]. A ghost triangle always
+    // has its infinite vertex in v[2] and its outside on the left of v[0]->v[1]
+    struct Triangle
+    {
+        int v[3];
+        int n[3];
+    };
+
+    struct BoundaryEdge
+    {
+        int from;
+        int to;
+        int outside;
+    };
+
+    const Vec2i& point(int index) const
+    {
+        return pts[index];
+    }
+
+    // index used by the per vertex scratch arrays, the ghost vertex goes last
+    int slot(int vertex) const
+    {
+        return vertex == ghost ? static_cast<int>(alias.size()) : vertex;
+    }
+
+    void mergeDuplicates()
+    {
+        const int count = pointCount;
+
+        order.resize(count);
+        for(int x = 0; x < count; x++)
+            order[x] = x;
+
+        std::sort(order.begin(), order.end(),
+                  [&](int i1, int i2)
+        {
+            const auto& p1 = point(i1);
+            const auto& p2 = point(i2);
+            if(p1.x != p2.x)
+                return p1.x < p2.x;
+            if(p1.y != p2.y)
+                return p1.y < p2.y;
+            return i1 < i2;
+        });
+
+        alias.resize(count);
+        for(int x = 0; x < count; x++)
+        {
+            const int index = order[x];
+            alias[index] = (x > 0 && point(order[x - 1]) == point(index)) ? alias[order[x - 1]] : index;
+        }
+
+        startLink.resize(count + 1);
+        endLink.resize(count + 1);
+    }
+
+    // every point on a single line, link them in order along it
+    void triangulateCollinear()
+    {
+        int previous = -1;
+        for(int index : order)
+        {
+            if(alias[index] != index)
+                continue;
+
+            if(previous != -1)
+                edges.emplace_back(std::min(previous, index), std::max(previous, index));
+
+            previous = index;
+        }
+
+        std::sort(edges.begin(), edges.end());
+    }
+
+    void createFirstTriangle(int a, int b, int c)
+    {
+        triangles.push_back({{a, b, c}, {}});
+        triangles.push_back({{b, a, ghost}, {}});
+        triangles.push_back({{c, b, ghost}, {}});
+        triangles.push_back({{a, c, ghost}, {}});
+
+        for(auto& t1 : triangles)
+        {
+            for(int i = 0; i < 3; i++)
+            {
+                for(int t2 = 0; t2 < static_cast<int>(triangles.size()); t2++)
+                {
+                    const auto& other = triangles[t2];
+                    for(int j = 0; j < 3; j++)
+                    {
+                        if(other.v[(j + 1) % 3] == t1.v[(i + 2) % 3] && other.v[(j + 2) % 3] == t1.v[(i + 1) % 3])
+                            t1.n[i] = t2;
+                    }
+                }
+            }
+        }
+
+        DUNGEON_STAT(trianglesCreated += triangles.size());
+
+        lastTriangle = 0;
+        inMark.assign(triangles.size(), 0);
+        outMark.assign(triangles.size(), 0);
+    }
+
+    bool isGhost(int t) const
+    {
+        return triangles[t].v[2] == ghost;
+    }
+
+    bool inConflict(int t, const Vec2i& p) const
+    {
+        const auto& tri = triangles[t];
+        const auto& a = point(tri.v[0]);
+        const auto& b = point(tri.v[1]);
+
+        if(tri.v[2] != ghost)
+            return inCircle(a, b, point(tri.v[2]), p) > 0;
+
+        const auto side = orient(a, b, p);
+        if(side != 0)
+            return side > 0;
+
+        // on the hull line, only conflicting when strictly inside the hull edge
+        const auto dot = (std::int64_t(p.x) - a.x) * (std::int64_t(b.x) - a.x) + (std::int64_t(p.y) - a.y) * (std::int64_t(b.y) - a.y);
+        const auto length = (std::int64_t(b.x) - a.x) * (std::int64_t(b.x) - a.x) + (std::int64_t(b.y) - a.y) * (std::int64_t(b.y) - a.y);
+        return dot > 0 && dot < length;
+    }
+
+    // visibility walk, always terminates on a Delaunay triangulation
+    int locate(const Vec2i& p) const
+    {
+        int t = lastTriangle;
+
+        while(!isGhost(t))
+        {
+            const auto& tri = triangles[t];
+
+            int next = -1;
+            for(int i = 0; i < 3 && next == -1; i++)
+            {
+                if(orient(point(tri.v[(i + 1) % 3]), point(tri.v[(i + 2) % 3]), p) < 0)
+                    next = tri.n[i];
+            }
+
+            if(next == -1)
+                break;
+
+            t = next;
+        }
+
+        return t;
+    }
+
+    void insert(int index)
+    {
+        const auto& p = point(index);
+
+        ++stamp;
+
+        cavity.clear();
+        boundary.clear();
+
+        const int start = locate(p);
+        inMark[start] = stamp;
+        pending.assign(1, start);
+
+        while(!pending.empty())
+        {
+            const int t = pending.back();
+            pending.pop_back();
+            cavity.push_back(t);
+
+            for(int i = 0; i < 3; i++)
+            {
+                const int neighbour = triangles[t].n[i];
+                if(inMark[neighbour] == stamp)
+                    continue;
+
+                if(outMark[neighbour] != stamp && inConflict(neighbour, p))
+                {
+                    inMark[neighbour] = stamp;
+                    pending.push_back(neighbour);
+                    continue;
+                }
+
+                outMark[neighbour] = stamp;
+                boundary.push_back({triangles[t].v[(i + 1) % 3], triangles[t].v[(i + 2) % 3], neighbour});
+            }
+        }
+
+        DUNGEON_STAT(trianglesDestroyed += cavity.size());
+        DUNGEON_STAT(trianglesCreated += boundary.size());
+
+        // the cavity is star shaped from p, fan it out from the boundary
+        newTriangles.clear();
+        for(std::size_t x = 0; x < boundary.size(); x++)
+        {
+            int t;
+            if(x < cavity.size())
+            {
+                t = cavity[x];
+            }
+            else
+            {
+                t = static_cast<int>(triangles.size());
+                triangles.emplace_back();
+                inMark.push_back(0);
+                outMark.push_back(0);
+            }
+
+            const auto& edge = boundary[x];
+            triangles[t] = {{edge.from, edge.to, index}, {-1, -1, edge.outside}};
+
+            auto& outside = triangles[edge.outside];
+            for(int i = 0; i < 3; i++)
+            {
+                if(outside.v[(i + 1) % 3] == edge.to && outside.v[(i + 2) % 3] == edge.from)
+                    outside.n[i] = t;
+            }
+
+            startLink[slot(edge.from)] = t;
+            endLink[slot(edge.to)] = t;
+            newTriangles.push_back(t);
+        }
+
+        for(int t : newTriangles)
+        {
+            auto& tri = triangles[t];
+            tri.n[0] = startLink[slot(tri.v[1])];
+            tri.n[1] = endLink[slot(tri.v[0])];
+        }
+
+        for(int t : newTriangles)
+        {
+            auto& tri = triangles[t];
+
+            if(tri.v[0] == ghost)
+                rotate(tri, 1);
+            else if(tri.v[1] == ghost)
+                rotate(tri, 2);
+            else
+                lastTriangle = t;
+        }
+    }
+
+    static void rotate(Triangle& tri, int shift)
+    {
+        const Triangle old = tri;
+        for(int i = 0; i < 3; i++)
+        {
+            tri.v[i] = old.v[(i + shift) % 3];
+            tri.n[i] = old.n[(i + shift) % 3];
+        }
+    }
+
+    void collectEdges()
+    {
+        for(const auto& tri : triangles)
+        {
+            if(tri.v[2] == ghost)
+                continue;
+
+            for(int i = 0; i < 3; i++)
+            {
+                const int from = tri.v[(i + 1) % 3];
+                const int to = tri.v[(i + 2) % 3];
+
+                // interior edges are seen twice, keep the one going up
+                if(from < to || isGhost(tri.n[i]))
+                    edges.emplace_back(std::min(from, to), std::max(from, to));
+            }
+        }
+
+        std::sort(edges.begin(), edges.end());
+    }
+
+    const Vec2i* pts = nullptr;
+    int pointCount = 0;
+
+    std::pmr::vector<Triangle> triangles;
+    std::pmr::vector<std::pair<int, int>> edges;
+
+    std::pmr::vector<int> order;
+    std::pmr::vector<int> alias;
+
+    std::pmr::vector<int> cavity;
+    std::pmr::vector<int> pending;
+    std::pmr::vector<int> newTriangles;
+    std::pmr::vector<BoundaryEdge> boundary;
+
+    std::pmr::vector<int> startLink;
+    std::pmr::vector<int> endLink;
+
+    std::pmr::vector<unsigned> inMark;
+    std::pmr::vector<unsigned> outMark;
+    unsigned stamp = 0;
+
+    int lastTriangle = 0;
+
+    std::uint64_t trianglesCreated = 0;
+    std::uint64_t trianglesDestroyed = 0;
+};
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+#include "vector2.hpp"
+#include "dungeonGenerator.hpp"
+
+// Many dungeons generated from the same parameters, stored as a struct of flat arrays.
+// The rooms of dungeon k are [roomOffsets[k], roomOffsets[k + 1]) in roomPos and roomSize,
+// the same goes for the corridors and the edges. Edges link rooms by their index among the
+// rooms of their dungeon. The tiles, when kept, are size.x * size.y kinds per dungeon one after the other.
+// clear() keeps the capacity, reuse the same batch to not allocate once it's big enough
+struct DungeonBatch
+{
+    Vec2i size;
+
+    std::vector<int> seeds;
+
+    std::vector<int> roomOffsets = {0};
+    std::vector<Vec2i> roomPos;
+    std::vector<Vec2i> roomSize;
+
+    std::vector<int> corridorOffsets = {0};
+    std::vector<Vec2i> corridorStart;
+    std::vector<Vec2i> corridorEnd;
+
+    std::vector<int> edgeOffsets = {0};
+    std::vector<int> edgeFirst;
+    std::vector<int> edgeSecond;
+
+    std::vector<Dungeon::Tile> tiles;
+
+    int getCount() const
+    {
+        return static_cast<int>(seeds.size());
+    }
+
+    int getRoomCount(int dungeon) const
+    {
+        return roomOffsets[dungeon + 1] - roomOffsets[dungeon];
+    }
+
+    int getCorridorCount(int dungeon) const
+    {
+        return corridorOffsets[dungeon + 1] - corridorOffsets[dungeon];
+    }
+
+    int getEdgeCount(int dungeon) const
+    {
+        return edgeOffsets[dungeon + 1] - edgeOffsets[dungeon];
+    }
+
+    // the tiles of the dungeon, nullptr if the batch doesn't keep them
+    const Dungeon::Tile* getTiles(int dungeon) const
+    {
+        return tiles.empty() ? nullptr : tiles.data() + std::size_t(dungeon) * size.x * size.y;
+    }
+
+    void clear()
+    {
+        seeds.clear();
+
+        roomOffsets.assign(1, 0);
+        roomPos.clear();
+        roomSize.clear();
+
+        corridorOffsets.assign(1, 0);
+        corridorStart.clear();
+        corridorEnd.clear();
+
+        edgeOffsets.assign(1, 0);
+        edgeFirst.clear();
+        edgeSecond.clear();
+
+        tiles.clear();
+    }
+
+    // add the dungeons of other after these ones, to merge the batches generated on several threads
+    void append(const DungeonBatch& other)
+    {
+        if(seeds.empty())
+            size = other.size;
+
+        seeds.insert(seeds.end(), other.seeds.begin(), other.seeds.end());
+
+        appendOffsets(roomOffsets, other.roomOffsets);
+        roomPos.insert(roomPos.end(), other.roomPos.begin(), other.roomPos.end());
+        roomSize.insert(roomSize.end(), other.roomSize.begin(), other.roomSize.end());
+
+        appendOffsets(corridorOffsets, other.corridorOffsets);
+        corridorStart.insert(corridorStart.end(), other.corridorStart.begin(), other.corridorStart.end());
+        corridorEnd.insert(corridorEnd.end(), other.corridorEnd.begin(), other.corridorEnd.end());
+
+        appendOffsets(edgeOffsets, other.edgeOffsets);
+        edgeFirst.insert(edgeFirst.end(), other.edgeFirst.begin(), other.edgeFirst.end());
+        edgeSecond.insert(edgeSecond.end(), other.edgeSecond.begin(), other.edgeSecond.end());
+
+        tiles.insert(tiles.end(), other.tiles.begin(), other.tiles.end());
+    }
+
+    // Write dungeon k in a Dungeon, for the code that expects one. Its parameters other than
+    // the seed and the size are left as they were, the tiles are only written if the batch keeps them
+    void extract(int dungeon, Dungeon& target) const
+    {
+        target.seed = seeds[dungeon];
+        target.size = size;
+
+        target.rooms.clear();
+        for(int room = roomOffsets[dungeon]; room < roomOffsets[dungeon + 1]; room++)
+            target.rooms.push_back({roomPos[room], roomSize[room]});
+
+        target.corridors.clear();
+        for(int corridor = corridorOffsets[dungeon]; corridor < corridorOffsets[dungeon + 1]; corridor++)
+            target.corridors.push_back({corridorStart[corridor], corridorEnd[corridor]});
+
+        const int firstRoom = roomOffsets[dungeon];
+        auto center = [&](int room)
+        {
+            return roomPos[firstRoom + room] + roomSize[firstRoom + room]/2;
+        };
+
+        target.edges.clear();
+        for(int edge = edgeOffsets[dungeon]; edge < edgeOffsets[dungeon + 1]; edge++)
+            target.edges.push_back({center(edgeFirst[edge]), center(edgeSecond[edge])});
+
+        if(const auto* kinds = getTiles(dungeon))
+        {
+            target.tiles.setSize(size);
+            std::copy(kinds, kinds + std::size_t(size.x) * size.y, target.tiles.tiles.begin());
+        }
+    }
+
+private:
+    static void appendOffsets(std::vector<int>& offsets, const std::vector<int>& other)
+    {
+        const int base = offsets.back();
+        for(std::size_t x = 1; x < other.size(); x++)
+            offsets.push_back(base + other[x]);
+    }
+};
+
+// Generate runs of seeds straight into a DungeonBatch.
+// The dungeons go one after the other through the same generator so they share its memory,
+// and their results are appended to the flat arrays of the batch without building a Dungeon
+// for each. Keep one per thread along with its batch, and append the batches in seed order.
+// Dungeons rejected by parameters.acceptance are left out, batch.seeds tells which were kept
+class BatchGenerator
+{
+public:
+    // Append the dungeons of the seeds [firstSeed, firstSeed + count) generated from parameters
+    // to batch, along with their tiles if keepTiles is set
+    void generate(const Dungeon& parameters, int firstSeed, int count, DungeonBatch& batch, bool keepTiles = false)
+    {
+        Dungeon dungeon = parameters;
+        batch.size = parameters.size;
+
+        for(int x = 0; x < count; x++)
+        {
+            dungeon.seed = firstSeed + x;
+
+            // when nothing changed the results of the previous call are still there
+            if(generator.run(dungeon) == GenerationResult::REJECTED)
+                continue;
+
+            batch.seeds.push_back(dungeon.seed);
+
+            for(const auto& room : generator.getRooms())
+            {
+                batch.roomPos.push_back(room.pos);
+                batch.roomSize.push_back(room.size);
+            }
+            batch.roomOffsets.push_back(static_cast<int>(batch.roomPos.size()));
+
+            for(const auto& corridor : generator.getCorridors())
+            {
+                batch.corridorStart.push_back(corridor.start);
+                batch.corridorEnd.push_back(corridor.end);
+            }
+            batch.corridorOffsets.push_back(static_cast<int>(batch.corridorStart.size()));
+
+            for(const auto& edge : generator.getRoomEdges())
+            {
+                batch.edgeFirst.push_back(edge.first);
+                batch.edgeSecond.push_back(edge.second);
+            }
+            batch.edgeOffsets.push_back(static_cast<int>(batch.edgeFirst.size()));
+
+            if(keepTiles)
+            {
+                const auto& kinds = generator.getTiles().tiles;
+                batch.tiles.insert(batch.tiles.end(), kinds.begin(), kinds.end());
+            }
+        }
+    }
+
+    const DungeonGenerator& getGenerator() const
+    {
+        return generator;
+    }
+
+private:
+    DungeonGenerator generator;
+};
@@ -0,0 +1,367 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <type_traits>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "vector2.hpp"
+#include "tilemap.hpp"
+#include "dungeonGenerator.hpp"
+
+// Binary dungeon file, written in one pass and read in place from memory.
+//
+//   header       DungeonFileHeader
+//   rooms        roomCount Dungeon::Room, 12 int32: pos, size, the 4 doors
+//   corridors    corridorCount Dungeon::Corridor, 4 int32: start, end
+//   edges        edgeCount Edge, 4 int32: p1, p2
+//   tiles        height rows of tileStride uint64, bit x % 64 of word x / 64 is tile x,
+//                the same layout as TileMap<bool>. Aligned on 32 bytes
+//   kinds        width * height Dungeon::Tile, one byte each, row after row.
+//                Only there if the dungeon has its tiles, kindsOffset is 0 otherwise
+//
+// Everything is little endian, offsets are from the start of the file.
+// The tables are the structs of the generator, a DungeonView hands out pointers in the file.
+
+static_assert(std::is_trivially_copyable<Dungeon::Room>::value && sizeof(Dungeon::Room) == 12 * sizeof(std::int32_t), "Dungeon::Room is stored as is");
+static_assert(std::is_trivially_copyable<Dungeon::Corridor>::value && sizeof(Dungeon::Corridor) == 4 * sizeof(std::int32_t), "Dungeon::Corridor is stored as is");
+static_assert(std::is_trivially_copyable<Edge>::value && sizeof(Edge) == 4 * sizeof(std::int32_t), "Edge is stored as is");
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "dungeon files are little endian"
+#endif
+
+struct DungeonFileHeader
+{
+    static constexpr std::uint32_t currentVersion = 2;
+    static constexpr std::size_t tileAlignment = 32;
+    static constexpr std::int32_t maxSide = 1 << 24; // largest width or height, the maps index their rows with ints
+
+    char magic[4] = {'D', 'G', 'N', 'B'};
+    std::uint32_t version = currentVersion;
+
+    std::int32_t width = 0;
+    std::int32_t height = 0;
+    std::int32_t seed = 0;
+
+    std::uint32_t roomCount = 0;
+    std::uint32_t corridorCount = 0;
+    std::uint32_t edgeCount = 0;
+
+    std::uint32_t tileStride = 0; // words per row
+    std::uint32_t reserved = 0;
+
+    std::uint64_t roomsOffset = 0;
+    std::uint64_t corridorsOffset = 0;
+    std::uint64_t edgesOffset = 0;
+    std::uint64_t tilesOffset = 0;
+    std::uint64_t kindsOffset = 0;
+    std::uint64_t fileSize = 0;
+};
+
+static_assert(sizeof(DungeonFileHeader) == 88, "the header has no padding");
+static_assert(sizeof(Dungeon::Tile) == 1, "Dungeon::Tile is stored as a byte");
+
+// Write the dungeon and the map generated for it, return false if the stream failed
+inline bool writeDungeon(std::ostream& out, const Dungeon& dungeon, const TileMap<bool>& map)
+{
+    DungeonFileHeader header;
+    header.width = map.getSize().x;
+    header.height = map.getSize().y;
+    header.seed = dungeon.seed;
+    header.roomCount = dungeon.rooms.size();
+    header.corridorCount = dungeon.corridors.size();
+    header.edgeCount = dungeon.edges.size();
+    header.tileStride = map.getStride();
+
+    header.roomsOffset = sizeof(DungeonFileHeader);
+    header.corridorsOffset = header.roomsOffset + header.roomCount * sizeof(Dungeon::Room);
+    header.edgesOffset = header.corridorsOffset + header.corridorCount * sizeof(Dungeon::Corridor);
+
+    const std::uint64_t tablesEnd = header.edgesOffset + header.edgeCount * sizeof(Edge);
+    header.tilesOffset = (tablesEnd + DungeonFileHeader::tileAlignment - 1) / DungeonFileHeader::tileAlignment * DungeonFileHeader::tileAlignment;
+    header.fileSize = header.tilesOffset + std::uint64_t(header.height) * header.tileStride * sizeof(TileMap<bool>::Word);
+
+    const bool hasKinds = dungeon.tiles.getSize() == map.getSize() && !dungeon.tiles.tiles.empty();
+    if(hasKinds)
+    {
+        header.kindsOffset = header.fileSize;
+        header.fileSize += dungeon.tiles.tiles.size();
+    }
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(dungeon.rooms.data()), header.roomCount * sizeof(Dungeon::Room));
+    out.write(reinterpret_cast<const char*>(dungeon.corridors.data()), header.corridorCount * sizeof(Dungeon::Corridor));
+    out.write(reinterpret_cast<const char*>(dungeon.edges.data()), header.edgeCount * sizeof(Edge));
+
+    const char padding[DungeonFileHeader::tileAlignment] = {};
+    out.write(padding, header.tilesOffset - tablesEnd);
+
+    for(int y = 0; y < header.height; y++)
+        out.write(reinterpret_cast<const char*>(map.row(y)), header.tileStride * sizeof(TileMap<bool>::Word));
+
+    if(hasKinds)
+        out.write(reinterpret_cast<const char*>(dungeon.tiles.tiles.data()), dungeon.tiles.tiles.size());
+
+    return bool(out);
+}
+
+inline bool writeDungeon(const char* path, const Dungeon& dungeon, const TileMap<bool>& map)
+{
+    std::ofstream file(path, std::ios::binary);
+    return file && writeDungeon(file, dungeon, map);
+}
+
+// Read only view of a dungeon file in memory, nothing is copied.
+// The memory must stay alive and be aligned on 8 bytes, which mapped files and allocations are
+class DungeonView
+{
+public:
+    DungeonView() = default;
+
+    // return false if it's not a valid dungeon file, the view is then empty
+    bool open(const void* data, std::size_t size)
+    {
+        header = nullptr;
+
+        if(size < sizeof(DungeonFileHeader) || reinterpret_cast<std::uintptr_t>(data) % alignof(std::uint64_t))
+            return false;
+
+        const auto* candidate = static_cast<const DungeonFileHeader*>(data);
+        const DungeonFileHeader expected;
+
+        if(std::memcmp(candidate->magic, expected.magic, sizeof(expected.magic)) || candidate->version != DungeonFileHeader::currentVersion)
+            return false;
+
+        if(candidate->width < 0 || candidate->height < 0 || candidate->width > DungeonFileHeader::maxSide || candidate->height > DungeonFileHeader::maxSide || candidate->fileSize > size)
+            return false;
+
+        // a row holds the width and at most the padding of TileMap<bool> rows, so the size of the
+        // tiles can't overflow below
+        const std::uint64_t rowWords = (std::uint64_t(candidate->width) + TileMap<bool>::wordBits - 1) / TileMap<bool>::wordBits;
+        if(candidate->tileStride < rowWords || candidate->tileStride >= rowWords + TileMap<bool>::rowAlignment)
+            return false;
+
+        auto fits = [&](std::uint64_t offset, std::uint64_t bytes, std::size_t alignment)
+        {
+            return offset % alignment == 0 && offset >= sizeof(DungeonFileHeader) && offset <= candidate->fileSize && bytes <= candidate->fileSize - offset;
+        };
+
+        if(
+            !fits(candidate->roomsOffset, std::uint64_t(candidate->roomCount) * sizeof(Dungeon::Room), alignof(Dungeon::Room)) ||
+            !fits(candidate->corridorsOffset, std::uint64_t(candidate->corridorCount) * sizeof(Dungeon::Corridor), alignof(Dungeon::Corridor)) ||
+            !fits(candidate->edgesOffset, std::uint64_t(candidate->edgeCount) * sizeof(Edge), alignof(Edge)) ||
+            !fits(candidate->tilesOffset, std::uint64_t(candidate->height) * candidate->tileStride * sizeof(TileMap<bool>::Word), alignof(TileMap<bool>::Word)) ||
+            (candidate->kindsOffset && !fits(candidate->kindsOffset, std::uint64_t(candidate->width) * candidate->height, 1)))
+            return false;
+
+        header = candidate;
+        return true;
+    }
+
+    bool isOpen() const
+    {
+        return header;
+    }
+
+    const DungeonFileHeader& getHeader() const
+    {
+        return *header;
+    }
+
+    Vec2i getSize() const
+    {
+        return {header->width, header->height};
+    }
+
+    int getSeed() const
+    {
+        return header->seed;
+    }
+
+    int getRoomCount() const
+    {
+        return header->roomCount;
+    }
+
+    const Dungeon::Room* getRooms() const
+    {
+        return at<Dungeon::Room>(header->roomsOffset);
+    }
+
+    int getCorridorCount() const
+    {
+        return header->corridorCount;
+    }
+
+    const Dungeon::Corridor* getCorridors() const
+    {
+        return at<Dungeon::Corridor>(header->corridorsOffset);
+    }
+
+    int getEdgeCount() const
+    {
+        return header->edgeCount;
+    }
+
+    const Edge* getEdges() const
+    {
+        return at<Edge>(header->edgesOffset);
+    }
+
+    const TileMap<bool>::Word* row(int y) const
+    {
+        return at<TileMap<bool>::Word>(header->tilesOffset) + std::size_t(y) * header->tileStride;
+    }
+
+    bool getTile(const Vec2i& pos) const
+    {
+        return row(pos.y)[pos.x / TileMap<bool>::wordBits] >> (pos.x % TileMap<bool>::wordBits) & 1;
+    }
+
+    bool hasKinds() const
+    {
+        return header->kindsOffset;
+    }
+
+    // the kinds of the tiles row after row, only if hasKinds()
+    const Dungeon::Tile* getKinds() const
+    {
+        return at<Dungeon::Tile>(header->kindsOffset);
+    }
+
+    Dungeon::Tile getKind(const Vec2i& pos) const
+    {
+        return getKinds()[std::size_t(pos.y) * header->width + pos.x];
+    }
+
+    // copy into a dungeon and a map, only the generated parts of the dungeon are written
+    void copyTo(Dungeon& dungeon, TileMap<bool>& map) const
+    {
+        dungeon.size = getSize();
+        dungeon.seed = getSeed();
+        dungeon.rooms.assign(getRooms(), getRooms() + getRoomCount());
+        dungeon.corridors.assign(getCorridors(), getCorridors() + getCorridorCount());
+        dungeon.edges.assign(getEdges(), getEdges() + getEdgeCount());
+
+        map.setSize(getSize());
+        for(int y = 0; y < header->height; y++)
+            std::memcpy(map.row(y), row(y), std::min<int>(map.getStride(), header->tileStride) * sizeof(TileMap<bool>::Word));
+
+        dungeon.tiles.setSize(hasKinds() ? getSize() : Vec2i());
+        if(hasKinds())
+            dungeon.tiles.tiles.assign(getKinds(), getKinds() + dungeon.tiles.tiles.size());
+    }
+
+private:
+    template <typename T>
+    const T* at(std::uint64_t offset) const
+    {
+        return reinterpret_cast<const T*>(reinterpret_cast<const char*>(header) + offset);
+    }
+
+    const DungeonFileHeader* header = nullptr;
+};
+
+// Read only file mapped in memory. Where mmap isn't available the file is read in a buffer
+class MappedFile
+{
+public:
+    MappedFile() = default;
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const char* path)
+    {
+        close();
+
+#if defined(_WIN32)
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if(!file)
+            return false;
+
+        size = file.tellg();
+        file.seekg(0);
+
+        // words so the data is aligned like a mapping
+        words.resize((size + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t));
+        if(!file.read(reinterpret_cast<char*>(words.data()), size))
+        {
+            close();
+            return false;
+        }
+
+        data = words.data();
+        return true;
+#else
+        const int descriptor = ::open(path, O_RDONLY);
+        if(descriptor == -1)
+            return false;
+
+        struct stat info;
+        if(::fstat(descriptor, &info) == -1 || info.st_size == 0)
+        {
+            ::close(descriptor);
+            return false;
+        }
+
+        void* mapping = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        ::close(descriptor);
+
+        if(mapping == MAP_FAILED)
+            return false;
+
+        data = mapping;
+        size = info.st_size;
+
+        return true;
+#endif
+    }
+
+    void close()
+    {
+#if defined(_WIN32)
+        std::vector<std::uint64_t>().swap(words);
+#else
+        if(data)
+            ::munmap(const_cast<void*>(data), size);
+#endif
+
+        data = nullptr;
+        size = 0;
+    }
+
+    const void* getData() const
+    {
+        return data;
+    }
+
+    std::size_t getSize() const
+    {
+        return size;
+    }
+
+private:
+    const void* data = nullptr;
+    std::size_t size = 0;
+
+#if defined(_WIN32)
+    std::vector<std::uint64_t> words;
+#endif
+};
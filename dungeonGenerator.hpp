@@ -1,271 +1,547 @@
 #pragma once
 
-#include <random>
+#include <array>
+#include <atomic>
 #include <vector>
-#include <functional>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <unordered_map>
 
+#include "vector2.hpp"
+#include "random.hpp"
 #include "tilemap.hpp"
+#include "delaunay.hpp"
+#include "spanningTree.hpp"
+#include "summedAreaTable.hpp"
+#include "spatialIndex.hpp"
+#include "navigation.hpp"
+#include "dungeonQuality.hpp"
+#include "placementFrontier.hpp"
+#include "generatorContext.hpp"
+#include "generatorStats.hpp"
+#include "threadPool.hpp"
 
 struct Edge
 {
-    sf::Vector2i p1;
-    sf::Vector2i p2;
+    Vec2i p1;
+    Vec2i p2;
 };
 
-struct Triangle
+inline bool operator == (const Edge &e1, const Edge &e2)
+{
+    return	(e1.p1 == e2.p1 && e1.p2 == e2.p2) ||
+            (e1.p1 == e2.p2 && e1.p2 == e2.p1);
+}
+
+inline std::vector<Edge> triangulate(const std::vector<Vec2i>& points)
+{
+    Triangulator triangulator;
+    triangulator.triangulate(points);
+
+    std::vector<Edge> edges;
+    for(const auto& edge : triangulator.getEdges())
+        edges.push_back({points[edge.first], points[edge.second]});
+
+    return edges;
+}
+
+inline std::vector<Edge> minimumSpanningTree(const std::vector<Edge>& edges)
 {
-    sf::Vector2i p1;
-    sf::Vector2i p2;
-    sf::Vector2i p3;
+    std::vector<Vec2i> nodes;
+    std::unordered_map<Vec2i, int> nodesIndex;
 
-    bool circumCircleContains(const sf::Vector2i &v) const
+    auto indexOf = [&](const Vec2i& node)
     {
-        float ab = (p1.x * p1.x) + (p1.y * p1.y);
-        float cd = (p2.x * p2.x) + (p2.y * p2.y);
-        float ef = (p3.x * p3.x) + (p3.y * p3.y);
+        auto it = nodesIndex.emplace(node, nodes.size());
+        if(it.second)
+            nodes.push_back(node);
 
-        float circum_x = (ab * (p3.y - p2.y) + cd * (p1.y - p3.y) + ef * (p2.y - p1.y)) / (p1.x * (p3.y - p2.y) + p2.x * (p1.y - p3.y) + p3.x * (p2.y - p1.y)) / 2.f;
-        float circum_y = (ab * (p3.x - p2.x) + cd * (p1.x - p3.x) + ef * (p2.x - p1.x)) / (p1.y * (p3.x - p2.x) + p2.y * (p1.x - p3.x) + p3.y * (p2.x - p1.x)) / 2.f;
-        float circum_radius = sqrtf(((p1.x - circum_x) * (p1.x - circum_x)) + ((p1.y - circum_y) * (p1.y - circum_y)));
+        return it.first->second;
+    };
 
-        float dist = std::sqrt(((v.x - circum_x) * (v.x - circum_x)) + ((v.y - circum_y) * (v.y - circum_y)));
-        return dist <= circum_radius;
-    }
+    std::vector<std::pair<int, int>> nodesEdges;
+    for(const auto& edge : edges)
+        nodesEdges.emplace_back(indexOf(edge.p1), indexOf(edge.p2));
+
+    std::vector<Edge> edgesFinal;
+    for(int edge : minimumSpanningTree(nodes, nodesEdges))
+        edgesFinal.push_back(edges[edge]);
+
+    return edgesFinal;
+}
+
+struct Dungeon
+{
+    int seed = 39129; // -1 for random;
+
+    int roomSizeMin = 3;
+    int roomSizeMax = 6;
+
+    Vec2i size = {50, 50};
+
+    int roomPoolSize = 50;
+
+    int minimalDirectionalRoomDistance = 7;
+    int minimalRoomDistance = 3;
+
+    int additionalEdge = 3;
+
+    enum SpanningTreeAlgorithm {KRUSKAL, PRIM};
 
-    bool containsVertex(const sf::Vector2i &v) const
+    SpanningTreeAlgorithm spanningTree = KRUSKAL;
+
+    // FRONTIER only tests the positions where the room can see the side it's placed from,
+    // EXHAUSTIVE tests every tile of the map. Both place the rooms at the same positions
+    enum PlacementMode {FRONTIER, EXHAUSTIVE};
+
+    PlacementMode placement = FRONTIER;
+
+    // also build navigation, the paths between the rooms and the flow fields over the tiles
+    bool buildNavigation = false;
+
+    // dungeons not meeting it are rejected, the generator stops at the first stage failing it
+    AcceptanceCriteria acceptance;
+
+    int minDoorDistToCorner = 1; //minimal distance betwindoweem corner and door, used so door don't spawindown on corner
+
+    struct Room
     {
-        return p1 == v || p2 == v || p3 == v;
-    }
+        Vec2i pos;
+        Vec2i size;
+
+        enum Side {UP, DOWN, LEFT, RIGHT};
+
+        std::array<Vec2i, 4> doors = {};
+    };
+
+    struct Corridor
+    {
+        Vec2i start;
+        Vec2i end;
+    };
+
+    enum Tile : std::uint8_t {EMPTY, WALL, ROOM, CORRIDOR, DOOR};
+
+    std::vector<Room> rooms;
+    std::vector<Corridor> corridors;
+
+    std::vector<Edge> edges;
+
+    // rooms and corridors carved in the map, a corridor tile entering a room is a door and
+    // the empty tiles around them are walls
+    TileMap<Tile> tiles;
+
+    // the rooms and corridors in grids, which room is a tile in, what's in a rect...
+    SpatialIndex index;
+
+    // empty unless buildNavigation is set and there are at most DungeonNavigation::maxRooms rooms
+    DungeonNavigation navigation;
 };
 
-inline bool operator == (const Triangle &t1, const Triangle &t2)
+// Shared with another thread to follow a generation and cancel it
+struct GenerationProgress
 {
-    return	(t1.p1 == t2.p1 || t1.p1 == t2.p2 || t1.p1 == t2.p3) &&
-            (t1.p2 == t2.p1 || t1.p2 == t2.p2 || t1.p2 == t2.p3) &&
-            (t1.p3 == t2.p1 || t1.p3 == t2.p2 || t1.p3 == t2.p3);
-}
+    std::atomic<bool> cancel{false};
 
-inline bool operator == (const Edge &e1, const Edge &e2)
-{
-    return	(e1.p1 == e2.p1 && e1.p2 == e2.p2) ||
-            (e1.p1 == e2.p2 && e1.p2 == e2.p1);
-}
+    std::atomic<int> stage{0};           // GeneratorStats::Stage running
+    std::atomic<float> stageProgress{0}; // from 0 to 1, only the placement reports it
+};
 
-inline float dist(const sf::Vector2i& v1, const sf::Vector2i& v2)
+// What a call to DungeonGenerator::generate or run did
+enum class GenerationResult
 {
-    auto delta = v1 - v2;
-	return std::sqrt(delta.x*delta.x + delta.y*delta.y);
-}
+    GENERATED,  // a new dungeon
+    UNCHANGED,  // nothing changed since the last call, the results are the ones it left
+    CANCELLED,  // cancelled through the progress
+    REJECTED    // it failed Dungeon::acceptance, getQuality() tells why
+};
 
-std::vector<Edge> triangulate(std::vector<sf::Vector2i> points)
+// Generate a dungeon in stages: room sizes, room placement, triangulation, spanning tree,
+// additional edges, corridors and navigation. Every stage keeps its result along with the parameters it
+// used and only runs again when one of them, or the result of a stage before it, changed.
+// Keep the same generator around so tweaking the late stages parameters is cheap.
+// Dungeons failing Dungeon::acceptance are rejected as soon as the stage measuring it is done.
+// All its memory goes through its GeneratorContext, once warmed up generating doesn't allocate.
+class DungeonGenerator
 {
-    auto min = points.front();
-    auto max = min;
+public:
+    DungeonGenerator() = default;
 
-    for(auto& point : points)
+    // the memory of the context comes from upstream, see GeneratorContext
+    explicit DungeonGenerator(std::pmr::memory_resource* upstream) : context(upstream)
     {
-        min.x = std::min(point.x, min.x);
-        min.y = std::min(point.y, min.y);
-        max.x = std::max(point.x, max.x);
-        max.y = std::max(point.y, max.y);
     }
 
-    auto delta = max - min;
-    int deltaMax = std::max(delta.x, delta.y);
-    auto mid = (min + max) / 2;
+    DungeonGenerator(const DungeonGenerator&) = delete;
+    DungeonGenerator& operator=(const DungeonGenerator&) = delete;
 
-    sf::Vector2i p1(mid.x - 20 * deltaMax, mid.y - deltaMax);
-    sf::Vector2i p2(mid.x, mid.y + 20 * deltaMax);
-    sf::Vector2i p3(mid.x + 20 * deltaMax, mid.y - deltaMax);
+    // Write the rooms, corridors and edges generated from the parameters of the dungeon.
+    // The dungeon is only written when the result is GENERATED. After a cancelled or
+    // rejected generation the next call starts over
+    GenerationResult generate(Dungeon& dungeon, GenerationProgress* progress = nullptr)
+    {
+        const auto result = run(dungeon, progress);
+        if(result == GenerationResult::GENERATED)
+            copyResults(dungeon);
 
-    std::vector<Triangle> triangles;
-    triangles.push_back({p1, p2, p3});
+        return result;
+    }
 
-    for(const auto& p : points)
+    // Copy the rooms, corridors, edges, tiles, index and navigation of the last run in dungeon,
+    // what generate() does when it's GENERATED. For a run that was UNCHANGED but whose results
+    // weren't kept the first time
+    void copyResults(Dungeon& dungeon) const
     {
-        std::vector<Triangle> badTriangles;
-        std::vector<Edge> polygon;
+        dungeon.rooms.assign(rooms.begin(), rooms.end());
+        dungeon.corridors.assign(corridors.begin(), corridors.end());
 
-        for(const auto& t : triangles)
+        dungeon.edges.clear();
+        for(const auto& edge : roomEdges)
+            dungeon.edges.push_back({roomPos[edge.first], roomPos[edge.second]});
+
+        dungeon.tiles = tiles;
+        dungeon.index = index;
+        dungeon.navigation = navigation;
+    }
+
+    // Same as generate but the results stay in the generator, read them with the getters.
+    // Saves copying them when they are only read or stored elsewhere. They only describe
+    // the dungeon when the result is GENERATED or UNCHANGED
+    GenerationResult run(const Dungeon& dungeon, GenerationProgress* progress = nullptr)
+    {
+        this->progress = progress;
+
+        const bool randomSeed = dungeon.seed == -1;
+        bool dirty = randomSeed || !generated;
+
+        context.reset();
+
+        quality = {};
+        stats = {};
+        DUNGEON_STAT(const auto allocationsBefore = context.getAllocationCount());
+        DUNGEON_STAT(ScopedTimer totalTimer(stats.totalTime));
+
+        if(update(sizesKey, {dungeon.seed, dungeon.roomSizeMin, dungeon.roomSizeMax, dungeon.roomPoolSize}) || dirty)
         {
-            if(t.circumCircleContains(p))
-            {
-                badTriangles.push_back(t);
-                polygon.push_back({t.p1, t.p2});
-                polygon.push_back({t.p2, t.p3});
-                polygon.push_back({t.p3, t.p1});
-            }
+            setStage(GeneratorStats::SIZES);
+            DUNGEON_STAT(auto timer = stats.time(GeneratorStats::SIZES));
+            seed = randomSeed ? systemSeed() : std::uint32_t(dungeon.seed);
+            generateSizes(dungeon);
+            dirty = true;
         }
 
-        triangles.erase(std::remove_if(triangles.begin(),triangles.end(),
-                                       [&badTriangles](const Triangle &t)
+        const bool placementDirty = update(placementKey, {dungeon.size.x, dungeon.size.y, dungeon.minimalDirectionalRoomDistance, dungeon.minimalRoomDistance, dungeon.placement}) || dirty;
+        if(placementDirty)
         {
-            return std::find(badTriangles.begin(), badTriangles.end(), t) != badTriangles.end();
+            if(isCancelled())
+                return cancel();
+
+            setStage(GeneratorStats::PLACEMENT);
+            DUNGEON_STAT(auto timer = stats.time(GeneratorStats::PLACEMENT));
+            placeRooms(dungeon);
+        }
 
-        }), triangles.end());
+        if(isCancelled())
+            return cancel();
 
-        std::vector<Edge> badEdges;
-        for(auto e1 = polygon.begin(); e1 != polygon.end(); e1++)
+        // a dungeon without enough rooms isn't worth triangulating
+        if(!acceptPlacement(dungeon))
+            return reject();
+
+        if(placementDirty)
         {
-            for(auto e2 = e1 + 1; e2 != polygon.end(); e2++)
             {
-                if(*e1 == *e2)
-                {
-                    badEdges.push_back(*e1);
-                    badEdges.push_back(*e2);
-                }
+                setStage(GeneratorStats::TRIANGULATION);
+                DUNGEON_STAT(auto timer = stats.time(GeneratorStats::TRIANGULATION));
+                triangulateRooms();
             }
+
+            DUNGEON_STAT(stats.trianglesCreated = triangulator.getTrianglesCreated());
+            DUNGEON_STAT(stats.trianglesDestroyed = triangulator.getTrianglesDestroyed());
+            dirty = true;
+        }
+
+        if(update(treeKey, {dungeon.spanningTree}) || dirty)
+        {
+            if(isCancelled())
+                return cancel();
+
+            setStage(GeneratorStats::SPANNING_TREE);
+            DUNGEON_STAT(auto timer = stats.time(GeneratorStats::SPANNING_TREE));
+            buildSpanningTree(dungeon);
+            dirty = true;
+        }
+
+        if(update(edgesKey, {dungeon.additionalEdge}) || dirty)
+        {
+            if(isCancelled())
+                return cancel();
+
+            setStage(GeneratorStats::EDGES);
+            DUNGEON_STAT(auto timer = stats.time(GeneratorStats::EDGES));
+            addEdges(dungeon);
+            dirty = true;
         }
 
-        polygon.erase(std::remove_if(begin(polygon), end(polygon),
-                                     [&badEdges](const Edge &e)
+        if(!acceptEdges(dungeon))
+            return reject();
+
+        if(update(corridorsKey, {dungeon.minDoorDistToCorner}) || dirty)
         {
-            return std::find(badEdges.begin(), badEdges.end(), e) != badEdges.end();
-        }), polygon.end());
+            if(isCancelled())
+                return cancel();
+
+            setStage(GeneratorStats::CORRIDORS);
+            DUNGEON_STAT(auto timer = stats.time(GeneratorStats::CORRIDORS));
+            buildCorridors(dungeon);
+            buildTiles();
+            index.build(map.getSize(), rooms, corridors);
+            measureCorridors();
+            dirty = true;
+        }
+
+        if(!acceptCorridors(dungeon))
+            return reject();
+
+        if(update(navigationKey, {dungeon.buildNavigation}) || dirty)
+        {
+            if(isCancelled())
+                return cancel();
+
+            setStage(GeneratorStats::NAVIGATION);
+            DUNGEON_STAT(auto timer = stats.time(GeneratorStats::NAVIGATION));
+
+            // build() leaves it empty past DungeonNavigation::maxRooms rooms
+            if(dungeon.buildNavigation)
+                navigation.build(rooms, roomEdges, map, context.scratch());
+            else
+                navigation.clear();
+
+            dirty = true;
+        }
+
+        if(isCancelled())
+            return cancel();
+
+        generated = true;
+        this->progress = nullptr;
+
+        rejections.add(DungeonQuality::ACCEPTED);
+
+        DUNGEON_STAT(stats.allocations = context.getAllocationCount() - allocationsBefore);
 
-        for(const auto& e : polygon)
-            triangles.push_back({e.p1, e.p2, p});
+        return dirty ? GenerationResult::GENERATED : GenerationResult::UNCHANGED;
     }
 
-    triangles.erase(std::remove_if(triangles.begin(), triangles.end(),
-                                   [&](const Triangle &t)
+    // Scan the room positions on pool, worth it on big maps, nullptr (the default) scans
+    // them on the calling thread. The dungeons are the same either way
+    void setThreadPool(ThreadPool* pool)
     {
-        return t.containsVertex(p1) || t.containsVertex(p2) || t.containsVertex(p3);
-    }), triangles.end());
+        this->pool = pool;
+    }
 
+    const std::pmr::vector<Dungeon::Room>& getRooms() const
+    {
+        return rooms;
+    }
 
-    std::vector<Edge> edges;
-    for(const auto& t : triangles)
+    const std::pmr::vector<Dungeon::Corridor>& getCorridors() const
     {
-        edges.push_back({t.p1, t.p2});
-        edges.push_back({t.p2, t.p3});
-        edges.push_back({t.p3, t.p1});
+        return corridors;
     }
 
-    return edges;
-}
+    // the edges as the indices of the rooms they link
+    const std::pmr::vector<std::pair<int, int>>& getRoomEdges() const
+    {
+        return roomEdges;
+    }
 
-std::vector<Edge> minimumSpanningTree(std::vector<Edge> edges)
-{
-    std::vector<sf::Vector2i> nodes;
-    for(const auto& edge : edges)
+    // the rooms and corridors of the last generated dungeon
+    const TileMap<bool>& getMap() const
     {
-        if(std::find(nodes.begin(), nodes.end(), edge.p1) == nodes.end())
-            nodes.push_back(edge.p1);
+        return map;
+    }
 
-        if(std::find(nodes.begin(), nodes.end(), edge.p2) == nodes.end())
-            nodes.push_back(edge.p2);
+    // the rooms and corridors of the last generated dungeon, a copy of Dungeon::index. Empty
+    // after a cancelled or rejected run, it never describes an older dungeon
+    const SpatialIndex& getIndex() const
+    {
+        return index;
     }
-    int uniqueCount = nodes.size();
 
-    std::vector<std::pair<int, int>> nodesEdges;
-    std::vector<std::pair<int, int>> nodesEdgesFinal;
-    for(const auto& edge : edges)
+    const DungeonNavigation& getNavigation() const
     {
-        nodesEdges.emplace_back(
-            std::find(nodes.begin(), nodes.end(), edge.p1) - nodes.begin(),
-            std::find(nodes.begin(), nodes.end(), edge.p2) - nodes.begin()
-        );
+        return navigation;
     }
 
-    std::sort(nodesEdges.begin(), nodesEdges.end(),
-              [&](const auto& n1, const auto& n2)
+    // the kind of every tile of the last generated dungeon, a copy of Dungeon::tiles
+    const TileMap<Dungeon::Tile>& getTiles() const
     {
-        return dist(nodes[n1.first], nodes[n1.second]) < dist(nodes[n2.first], nodes[n2.second]);
-    });
+        return tiles;
+    }
 
-    std::vector<int> fathers;
-    for(int x = 0; x < uniqueCount; x++)
-        fathers.push_back(x);
+    // what the last dungeon measured against its acceptance criteria, and why it was rejected if it was
+    const DungeonQuality& getQuality() const
+    {
+        return quality;
+    }
 
-    std::function<int(int)> find = [&](int x)
+    // runs accepted and rejected by the reason since the generator was created, one per run
+    // that wasn't cancelled, the ones answered from the cache included
+    const RejectionStats& getRejectionStats() const
     {
-        if(fathers[x] != x)
-            fathers[x] = find(fathers[x]);
+        return rejections;
+    }
 
-        return fathers[x];
-    };
+    const GeneratorContext& getContext() const
+    {
+        return context;
+    }
 
-    for(const auto& edge : nodesEdges)
+    // what the last call to generate did, all zero unless DUNGEON_STATS is enabled
+    const GeneratorStats& getStats() const
     {
-        if(find(edge.first) == find(edge.second))
-            continue;
+        return stats;
+    }
 
-        nodesEdgesFinal.emplace_back(edge.first, edge.second);
+private:
+    template <std::size_t Size>
+    static bool update(std::array<int, Size>& key, const std::array<int, Size>& value)
+    {
+        if(key == value)
+            return false;
 
-        fathers[find(edge.first)] = find(edge.second);
+        key = value;
+        return true;
     }
 
-    std::vector<Edge> edgesFinal;
-    for(const auto& edge : nodesEdgesFinal)
-        edgesFinal.push_back({nodes[edge.first], nodes[edge.second]});
+    bool isCancelled() const
+    {
+        return progress && progress->cancel;
+    }
 
-    return edgesFinal;
-}
+    // The stages ran so far don't match their keys anymore, start over on the next call.
+    // The index and navigation would describe an older dungeon, they are emptied
+    GenerationResult cancel()
+    {
+        generated = false;
+        progress = nullptr;
 
-struct Dungeon
-{
-    int seed = 39129; // -1 for random;
+        index.clear();
+        navigation.clear();
 
-    int roomSizeMin = 3;
-    int roomSizeMax = 6;
+        return GenerationResult::CANCELLED;
+    }
 
-    sf::Vector2i size = {50, 50};
+    // like a cancel, the stages after the one rejecting the dungeon didn't run
+    GenerationResult reject()
+    {
+        rejections.add(quality.rejection);
+        cancel();
+        return GenerationResult::REJECTED;
+    }
 
-    int roomPoolSize = 50;
+    bool acceptPlacement(const Dungeon& dungeon)
+    {
+        const auto& criteria = dungeon.acceptance;
 
-    int minimalDirectionalRoomDistance = 7;
-    int minimalRoomDistance = 3;
+        int area = 0;
+        for(const auto& room : rooms)
+            area += room.size.x * room.size.y;
 
-    int additionalEdge = 3;
+        const int mapArea = dungeon.size.x * dungeon.size.y;
 
-    int minDoorDistToCorner = 1; //minimal distance betwindoweem corner and door, used so door don't spawindown on corner
+        quality.rooms = static_cast<int>(rooms.size());
+        quality.coverage = mapArea > 0 ? float(area) / mapArea : 0;
 
-    struct Room
+        if(quality.rooms < criteria.minRooms)
+            quality.rejection = DungeonQuality::TOO_FEW_ROOMS;
+        else if(quality.coverage < criteria.minCoverage)
+            quality.rejection = DungeonQuality::LOW_COVERAGE;
+
+        return quality.rejection == DungeonQuality::ACCEPTED;
+    }
+
+    bool acceptEdges(const Dungeon& dungeon)
     {
-        sf::Vector2i pos;
-        sf::Vector2i size;
+        const auto& criteria = dungeon.acceptance;
 
-        enum Side {UP, DOWN, LEFT, RIGHT};
+        quality.loops = static_cast<int>(roomEdges.size() - treeEdges.size());
+        if(quality.loops < criteria.minLoops)
+        {
+            quality.rejection = DungeonQuality::TOO_FEW_LOOPS;
+            return false;
+        }
 
-        std::array<sf::Vector2i, 4> doors = {};
-    };
+        if(!criteria.minDiameter && !criteria.maxDiameter)
+            return true;
 
-    struct Corridor
+        // the search stops as soon as the diameter settles the criteria
+        const int stopAbove = criteria.maxDiameter ? criteria.maxDiameter : criteria.minDiameter - 1;
+        quality.diameter = roomGraphDiameter(quality.rooms, roomEdges, stopAbove, context.scratch());
+
+        if(quality.diameter < criteria.minDiameter || (criteria.maxDiameter && quality.diameter > criteria.maxDiameter))
+            quality.rejection = DungeonQuality::DIAMETER;
+
+        return quality.rejection == DungeonQuality::ACCEPTED;
+    }
+
+    bool acceptCorridors(const Dungeon& dungeon)
     {
-        sf::Vector2i start;
-        sf::Vector2i end;
-    };
+        quality.roomCrossings = roomCrossings;
+        quality.corridorOverlaps = corridorOverlaps;
 
-    std::vector<Room> rooms;
-    std::vector<Corridor> corridors;
+        if(dungeon.acceptance.noRoomCrossings && roomCrossings)
+            quality.rejection = DungeonQuality::ROOM_CROSSINGS;
 
-    std::vector<Edge> edges;
-};
+        return quality.rejection == DungeonQuality::ACCEPTED;
+    }
 
-inline void generateDungeon(Dungeon& dungeon)
-{
-    using RndEngine = std::mt19937;
-    using RndDist = std::uniform_int_distribution<RndEngine::result_type>;
+    // The rooms and corridors overlapping every corridor, from the index. A corridor counts the
+    // rooms it crosses besides the two it joins and the corridors of other edges it meets
+    void measureCorridors()
+    {
+        roomCrossings = 0;
+        corridorOverlaps = 0;
 
-    RndEngine rng;
-    rng.seed(dungeon.seed == -1 ? std::random_device()() : dungeon.seed);
+        const auto& corridorRects = index.getCorridors();
+        for(int corridor = 0; corridor < corridorRects.size(); corridor++)
+        {
+            const auto& edge = roomEdges[corridorEdges[corridor]];
 
-    RndDist roomSizeDist(dungeon.roomSizeMin, dungeon.roomSizeMax);
+            const Vec2i pos = corridorRects.getBegin(corridor);
+            const Vec2i size = corridorRects.getEnd(corridor) - pos;
 
-    TileMap<bool> map;
-    map.setSize({dungeon.size.x, dungeon.size.y});
+            index.forEachRoomInRect(pos, size, [&](int room)
+            {
+                roomCrossings += room != edge.first && room != edge.second;
+            });
 
-    RndDist roomPosDist(0, map.getSize().x);
+            // every pair once, from its first corridor
+            index.forEachCorridorInRect(pos, size, [&](int other)
+            {
+                corridorOverlaps += other > corridor && corridorEdges[other] != corridorEdges[corridor];
+            });
+        }
+    }
 
-    auto rnd =
-        [&](int min, int max)
+    void setStage(GeneratorStats::Stage stage)
     {
-        return RndDist(min, max)(rng);
-    };
+        if(progress)
+        {
+            progress->stage = stage;
+            progress->stageProgress = 0;
+        }
+    }
+
+    // the numbers drawn by a stage, or by an item of it, for the seed of the run
+    RandomStream random(GeneratorStats::Stage stage, int index = 0) const
+    {
+        return RandomStream(seed, {std::uint32_t(stage), std::uint32_t(index)});
+    }
 
-    auto placeRoom =
-        [&](auto pos, auto size)
+    static void carve(TileMap<bool>& map, Vec2i pos, Vec2i size)
     {
         if(size.x < 0)
         {
@@ -279,17 +555,19 @@ inline void generateDungeon(Dungeon& dungeon)
             pos.y -= size.y;
         }
 
-        for(int x = 0; x < size.x; x++)
-        {
-            for(int y = 0; y < size.y; y++)
-            {
-                map.setTile({x + pos.x, y + pos.y}, true);
-            }
-        }
-    };
+        map.fillRect(pos, size);
+    }
 
-    auto canPlaceRoom =
-        [&](auto pos, auto size)
+    // rooms are also added to the occupancy table used by canPlaceRoom and to the frontier
+    void placeRoom(Vec2i pos, Vec2i size)
+    {
+        carve(roomMap, pos, size);
+        occupancy.fillRect(pos, size);
+        frontier.fillRect(pos, size);
+    }
+
+    // only reads the maps, rows are scanned from several threads at once
+    bool canPlaceRoom(Vec2i pos, Vec2i size) const
     {
         if(size.x < 0)
         {
@@ -303,278 +581,653 @@ inline void generateDungeon(Dungeon& dungeon)
             pos.y -= size.y;
         }
 
-        if(map.getSize().x <= pos.x + size.x || map.getSize().y <= pos.y + size.y)
+        if(roomMap.getSize().x <= pos.x + size.x || roomMap.getSize().y <= pos.y + size.y)
             return false;
 
         if(pos.x < 0 || pos.y < 0)
             return false;
 
-        for(int x = 0; x < size.x; x++)
+        return occupancy.isEmpty(pos, size);
+    }
+
+    // Pool of pregenerated room size
+    void generateSizes(const Dungeon& dungeon)
+    {
+        // a stream per room, growing the pool keeps the sizes already in it
+        roomSizePool.clear();
+        for(int x = 0; x < dungeon.roomPoolSize; x++)
         {
-            for(int y = 0; y < size.y; y++)
-            {
-                if(map.getTile({x + pos.x, y + pos.y}))
-                    return false;
-            }
+            auto rnd = random(GeneratorStats::SIZES, x);
+
+            const int width = rnd.uniform(dungeon.roomSizeMin, dungeon.roomSizeMax);
+            const int height = rnd.uniform(dungeon.roomSizeMin, dungeon.roomSizeMax);
+            roomSizePool.emplace_back(width, height);
         }
+    }
 
-        return true;
+    // How a room is scanned for when placed from one side of the map.
+    // x runs along the side the room is placed from and y away from it, line x is
+    // only tested from row clearDistances[x] on and no line before row start
+    struct PlacementScan
+    {
+        explicit PlacementScan(std::pmr::memory_resource* resource) : clearDistances(resource)
+        {
+        }
+
+        int dir = Dungeon::Room::UP;
+        Vec2i posDiff;
+        Vec2i offset;
+        bool swapX = false;
+
+        std::pmr::vector<int> clearDistances;
+        int lineCount = 0;
+        int start = 0;
     };
 
-    // Pool of pregenerated room size
-    std::vector<sf::Vector2i> roomSizePool;
-    for(int x = 0; x < dungeon.roomPoolSize; x++)
-        roomSizePool.emplace_back(roomSizeDist(rng), roomSizeDist(rng));
+    struct ScanCounts
+    {
+        std::uint64_t positions = 0;
+        std::uint64_t queries = 0;
+    };
+
+    void setupScan(const Dungeon& dungeon, int dir, const Vec2i& room, PlacementScan& scan) const
+    {
+        const int offsetInt = dungeon.minimalDirectionalRoomDistance;
+
+        scan.dir = dir;
+
+        if(dir == Dungeon::Room::UP) // up
+        {
+            scan.posDiff = {0, 0};
+            scan.offset = {0, offsetInt};
+            scan.swapX = false;
+        }
+        else if(dir == Dungeon::Room::LEFT) // left
+        {
+            scan.posDiff = {0, 0};
+            scan.offset = {offsetInt, 0};
+            scan.swapX = true;
+        }
+        else if(dir == Dungeon::Room::DOWN) // dowindown
+        {
+            scan.posDiff = {0, roomMap.getSize().y - 1};
+            scan.offset = {0, -offsetInt};
+            scan.swapX = false;
+        }
+        else if(dir == Dungeon::Room::RIGHT) // right
+        {
+            scan.posDiff = {roomMap.getSize().x - 1, 0};
+            scan.offset = {-offsetInt, 0};
+            scan.swapX = true;
+        }
 
-    std::vector<Dungeon::Room>& placedRoom = dungeon.rooms;
+        if(dungeon.placement == Dungeon::FRONTIER && room.x > 0 && room.y > 0)
+        {
+            // the sight check passes from the clear distance of the lines covered by the
+            // room and onward, the positions before it can be skipped
+            const auto side = static_cast<PlacementFrontier::Side>(dir);
+            frontier.getClearDistances(side, scan.swapX ? room.y : room.x, scan.clearDistances);
 
-    // get the size for the first room
-    auto firstRoom = roomSizePool.back();
-    roomSizePool.pop_back();
+            scan.lineCount = std::min<int>(scan.clearDistances.size(), roomMap.getSize().x);
 
-    // insert the first room on the middle of the map and in the placed room list
-    placeRoom(map.getSize()/2, firstRoom);
-    placedRoom.push_back({map.getSize()/2, firstRoom});
+            scan.start = PlacementFrontier::never;
+            for(int x = 0; x < scan.lineCount; x++)
+                scan.start = std::min(scan.start, scan.clearDistances[x]);
+        }
+        else
+        {
+            scan.lineCount = roomMap.getSize().x;
+            scan.clearDistances.assign(scan.lineCount, 0);
+            scan.start = 0;
+        }
+    }
 
-    while(!roomSizePool.empty())
+    // call found(pos) for every position of row y the room can be placed at
+    template <typename Found>
+    void scanRow(const Dungeon& dungeon, const PlacementScan& scan, const Vec2i& room, int y, ScanCounts& counts, Found found) const
     {
-        const auto originDir = rnd(Dungeon::Room::UP, Dungeon::Room::RIGHT);
-        auto dir = originDir;
+        // on a map a tile high (or wide) there's nothing to flip, the rows from the bottom (right) are the ones from the top (left)
+        switch(scan.dir)
+        {
+            case Dungeon::Room::UP:
+                return scanRowFrom<Dungeon::Room::UP>(dungeon, scan, room, y, counts, found);
+            case Dungeon::Room::DOWN:
+                if(scan.posDiff.y)
+                    return scanRowFrom<Dungeon::Room::DOWN>(dungeon, scan, room, y, counts, found);
+                return scanRowFrom<Dungeon::Room::UP>(dungeon, scan, room, y, counts, found);
+            case Dungeon::Room::LEFT:
+                return scanRowFrom<Dungeon::Room::LEFT>(dungeon, scan, room, y, counts, found);
+            case Dungeon::Room::RIGHT:
+                if(scan.posDiff.x)
+                    return scanRowFrom<Dungeon::Room::RIGHT>(dungeon, scan, room, y, counts, found);
+                return scanRowFrom<Dungeon::Room::LEFT>(dungeon, scan, room, y, counts, found);
+        }
+    }
+
+    // A loop per side, the axis swap and flip are known at compile time and what only depends
+    // on the row (how far from the side and the sight check) is computed once per row
+    template <int Dir, typename Found>
+    void scanRowFrom(const Dungeon& dungeon, const PlacementScan& scan, const Vec2i& room, int y, ScanCounts& counts, Found found) const
+    {
+        constexpr bool swapX = Dir == Dungeon::Room::LEFT || Dir == Dungeon::Room::RIGHT;
+        constexpr bool flip = Dir == Dungeon::Room::DOWN || Dir == Dungeon::Room::RIGHT;
+
+        const Vec2i mapSize = roomMap.getSize();
+        const int minimalDist = dungeon.minimalRoomDistance;
+        const Vec2i spacing = room + Vec2i(minimalDist*2, minimalDist*2);
 
-        auto room = roomSizePool.back();
-        roomSizePool.pop_back();
+        // distance from the side in map coordinates and the size of the sight check toward it
+        const int away = flip ? (swapX ? scan.posDiff.x : scan.posDiff.y) - y : y;
+        const int sight = flip ? -away : (swapX ? mapSize.x : mapSize.y) - away - 1;
+        const Vec2i sightCheckSize = swapX ? Vec2i(sight, room.y) : Vec2i(room.x, sight);
 
-        do
+        auto fits = [&](const Vec2i& pos, const Vec2i& size)
         {
-            std::vector<sf::Vector2i> possiblePos;
+            DUNGEON_STAT(counts.queries++);
+            return canPlaceRoom(pos, size);
+        };
 
-            const int offsetInt = dungeon.minimalDirectionalRoomDistance;
-            const int minimalDist = dungeon.minimalRoomDistance;
+        for(int x = 0; x < scan.lineCount; x++)
+        {
+            if(scan.clearDistances[x] > y)
+                continue;
+
+            DUNGEON_STAT(counts.positions++);
 
-            sf::Vector2i posDiff;
-            sf::Vector2i offset;
-            sf::Vector2i sideOffset;
-            bool swapX = false;
+            const Vec2i pos = swapX ? Vec2i(away, x) : Vec2i(x, away);
 
-            if(dir == Dungeon::Room::UP) // up
+            if(
+                fits(pos, room) &&
+                fits(pos + scan.offset - Vec2i(minimalDist, minimalDist), spacing) &&
+                fits(pos + scan.offset, room) &&
+                fits(pos, sightCheckSize))
+                found(pos + scan.offset);
+        }
+
+        (void)counts;
+    }
+
+    void addCounts(const ScanCounts& counts)
+    {
+        DUNGEON_STAT(stats.candidatePositions += counts.positions);
+        DUNGEON_STAT(stats.rectQueries += counts.queries);
+        (void)counts;
+    }
+
+    // Try the directions in turn from originDir, write in possiblePos the positions of the
+    // first row the room fits in and return the number of directions tried before it, -1 if
+    // it fits nowhere
+    int findPositions(const Dungeon& dungeon, int originDir, const Vec2i& room, std::pmr::vector<Vec2i>& possiblePos)
+    {
+        if(pool)
+            return findPositionsParallel(dungeon, originDir, room, possiblePos);
+
+        auto& scan = scans[0];
+        ScanCounts counts;
+
+        for(int tried = 0; tried < 4; tried++)
+        {
+            setupScan(dungeon, (originDir + tried) % 4, room, scan);
+
+            possiblePos.clear();
+            for(int y = scan.start; y < roomMap.getSize().y && possiblePos.empty(); y++)
+                scanRow(dungeon, scan, room, y, counts, [&](const Vec2i& pos){possiblePos.push_back(pos);});
+
+            //if windowe found some possible position then go to next step: choosing one
+            if(!possiblePos.empty())
             {
-                posDiff = {0, 0};
-                offset = {0, offsetInt};
-                sideOffset = {1, 0};
+                addCounts(counts);
+                return tried;
             }
-            else if(dir == Dungeon::Room::LEFT) // left
+        }
+
+        addCounts(counts);
+        return -1;
+    }
+
+    // Same result as the sequential scan, the rows are scanned in waves of pool->size() rows
+    // for each direction not settled yet. A direction is settled once a row has positions or
+    // it ran out of rows, the first one in order with positions wins. Later directions keep
+    // the row they found and only scan it again if every direction before them ran out
+    int findPositionsParallel(const Dungeon& dungeon, int originDir, const Vec2i& room, std::pmr::vector<Vec2i>& possiblePos)
+    {
+        const Vec2i mapSize = roomMap.getSize();
+        const int rows = pool->size();
+
+        std::array<int, 4> next;
+        std::array<bool, 4> found = {};
+
+        for(int tried = 0; tried < 4; tried++)
+        {
+            setupScan(dungeon, (originDir + tried) % 4, room, scans[tried]);
+            next[tried] = std::min(scans[tried].start, mapSize.y);
+        }
+
+        auto settled = [&](int tried)
+        {
+            return found[tried] || next[tried] >= mapSize.y;
+        };
+
+        int current = 0;
+        while(current < 4)
+        {
+            if(isCancelled())
+                return -1;
+
+            const int taskCount = (4 - current) * rows;
+
+            waveFound.assign(taskCount, 0);
+#if DUNGEON_STATS
+            waveCounts.assign(taskCount, {});
+#endif
+            if(static_cast<int>(wavePositions.size()) < taskCount * mapSize.x)
+                wavePositions.resize(taskCount * mapSize.x);
+
+            pool->parallelFor(0, taskCount, [&](int task)
             {
-                posDiff = {0, 0};
-                offset = {offsetInt, 0};
-                sideOffset = {0, 1};
-                swapX = true;
-            }
-            else if(dir == Dungeon::Room::DOWN) // dowindown
+                const int tried = current + task / rows;
+                const int y = next[tried] + task % rows;
+
+                if(settled(tried) || y >= mapSize.y)
+                    return;
+
+                Vec2i* positions = wavePositions.data() + task * mapSize.x;
+                int& count = waveFound[task];
+
+                ScanCounts counts;
+                scanRow(dungeon, scans[tried], room, y, counts, [&](const Vec2i& pos){positions[count++] = pos;});
+                DUNGEON_STAT(waveCounts[task] = counts);
+            });
+
+            DUNGEON_STAT(for(const auto& counts : waveCounts) addCounts(counts));
+
+            for(int tried = current; tried < 4; tried++)
             {
-                posDiff = {0, map.getSize().y - 1};
-                offset = {0, -offsetInt};
-                sideOffset = {1, 0};
+                if(settled(tried))
+                    continue;
+
+                const int first = (tried - current) * rows;
+
+                int row = 0;
+                while(row < rows && !waveFound[first + row])
+                    row++;
+
+                if(row == rows)
+                {
+                    next[tried] += rows;
+                    continue;
+                }
+
+                if(tried == current)
+                {
+                    const Vec2i* positions = wavePositions.data() + (first + row) * mapSize.x;
+                    possiblePos.assign(positions, positions + waveFound[first + row]);
+                    return tried;
+                }
+
+                found[tried] = true;
+                next[tried] += row;
             }
-            else if(dir == Dungeon::Room::RIGHT) // right
+
+            while(current < 4 && settled(current))
             {
-                posDiff = {map.getSize().x - 1, 0};
-                offset = {-offsetInt, 0};
-                sideOffset = {0, 1};
-                swapX = true;
+                if(found[current])
+                {
+                    ScanCounts counts;
+                    possiblePos.clear();
+                    scanRow(dungeon, scans[current], room, next[current], counts, [&](const Vec2i& pos){possiblePos.push_back(pos);});
+                    addCounts(counts);
+                    return current;
+                }
+
+                current++;
             }
+        }
 
-            dir++;
-            if(dir == Dungeon::Room::RIGHT + 1)
-                dir = Dungeon::Room::UP;
+        return -1;
+    }
 
-            for(int y = 0; y < map.getSize().y; y++)
-            {
-                for(int x = 0; x < map.getSize().x; x++)
-                {
-                    sf::Vector2i pos = {x, y};
+    void placeRooms(const Dungeon& dungeon)
+    {
+        roomMap.setSize(dungeon.size);
+        occupancy.setSize(dungeon.size);
+        frontier.setSize(dungeon.size);
 
-                    if(swapX)
-                        std::swap(pos.x, pos.y);
+        std::pmr::vector<Vec2i> sizePool(roomSizePool, context.scratch());
+        std::pmr::vector<Vec2i> possiblePos(context.scratch());
 
-                    if(posDiff.x)
-                        pos.x = posDiff.x - pos.x;
-                    if(posDiff.y)
-                        pos.y = posDiff.y - pos.y;
+        auto& placedRoom = rooms;
+        placedRoom.clear();
 
-                    auto sightCheckSize = room;
+        if(sizePool.empty())
+            return;
 
-                    if(swapX)
-                    {
-                        if(posDiff.x)
-                            sightCheckSize.x = -pos.x;
-                        else
-                            sightCheckSize.x = map.getSize().x - pos.x - 1;
-                    }
-                    else
-                    {
-                        if(posDiff.y)
-                            sightCheckSize.y = -pos.y;
-                        else
-                            sightCheckSize.y = map.getSize().y - pos.y - 1;
-                    }
+        // get the size for the first room
+        auto firstRoom = sizePool.back();
+        sizePool.pop_back();
 
-                    if(
-                        canPlaceRoom(pos, room) &&
-                        canPlaceRoom(pos + offset - sf::Vector2i(minimalDist, minimalDist), room + sf::Vector2i(minimalDist*2, minimalDist*2)) &&
-                        canPlaceRoom(pos + offset, room) &&
-                        canPlaceRoom(pos, sightCheckSize))
-                        possiblePos.push_back(pos + offset);
-                }
+        // insert the first room on the middle of the map and in the placed room list
+        placeRoom(roomMap.getSize()/2, firstRoom);
+        placedRoom.push_back({roomMap.getSize()/2, firstRoom});
 
-                //if windowe found some possible position then go to next step: choosing one
-                if(!possiblePos.empty())
-                    break;
+        while(!sizePool.empty())
+        {
+            if(progress)
+            {
+                if(progress->cancel)
+                    return;
+
+                progress->stageProgress = 1 - float(sizePool.size()) / roomSizePool.size();
             }
 
-            if(!possiblePos.empty())
-            {
-                auto pos = possiblePos[rnd(0, possiblePos.size() - 1)];
+            auto room = sizePool.back();
+            sizePool.pop_back();
+
+            // the stream of the room is the one of its index in the pool
+            auto rnd = random(GeneratorStats::PLACEMENT, sizePool.size());
 
-                placeRoom(pos, room);
-                placedRoom.push_back({pos, room});
+            const auto originDir = rnd.uniform(Dungeon::Room::UP, Dungeon::Room::RIGHT);
 
+            const int tried = findPositions(dungeon, originDir, room, possiblePos);
+            if(tried == -1)
                 break;
-            }
 
-            continue;
-        }
-        while(dir != originDir);
+            auto pos = possiblePos[rnd.uniform(0, possiblePos.size() - 1)];
 
-        if(dir == originDir)
-            break;
-    }
+            placeRoom(pos, room);
+            placedRoom.push_back({pos, room});
 
-    std::vector<sf::Vector2i> roomPos;
-    for(const auto& room : placedRoom)
-        roomPos.push_back(room.pos + room.size/2);
+            // the placement has always stopped after a room placed from the last direction tried
+            if(tried == 3)
+                break;
+        }
+    }
 
-    auto edges = triangulate(roomPos);
-    auto& minimumEdges = dungeon.edges;
-    minimumEdges = minimumSpanningTree(edges);
+    void triangulateRooms()
+    {
+        roomPos.clear();
+        for(const auto& room : rooms)
+            roomPos.push_back(room.pos + room.size/2);
 
-    for(const auto& edge : minimumEdges)
-        edges.erase(std::remove(edges.begin(), edges.end(), edge), edges.end());
+        triangulator.triangulate(roomPos);
+    }
 
-    for(int x = 0; x < dungeon.additionalEdge && edges.size();  x++)
+    void buildSpanningTree(const Dungeon& dungeon)
     {
-        auto edge = edges[rnd(0, edges.size() - 1)];
-        edges.erase(std::remove(edges.begin(), edges.end(), edge), edges.end());
+        const auto& edges = triangulator.getEdges();
 
-        minimumEdges.push_back(edge);
+        if(dungeon.spanningTree == Dungeon::PRIM)
+            treeEdges = primSpanningTree(roomPos, edges, context.scratch());
+        else
+            treeEdges = minimumSpanningTree(roomPos, edges, context.scratch());
     }
 
-    std::vector<std::pair<int, int>> roomEdges;
-    for(const auto& edge : minimumEdges)
+    void addEdges(const Dungeon& dungeon)
     {
-        roomEdges.emplace_back(
-            std::find(roomPos.begin(), roomPos.end(), edge.p1) - roomPos.begin(),
-            std::find(roomPos.begin(), roomPos.end(), edge.p2) - roomPos.begin()
-        );
-    }
+        const auto& edges = triangulator.getEdges();
+
+        std::pmr::vector<bool> inTree(edges.size(), false, context.scratch());
+        for(int edge : treeEdges)
+            inTree[edge] = true;
+
+        std::pmr::vector<int> remainingEdges(context.scratch());
+        remainingEdges.reserve(edges.size());
+        for(int x = 0; x < static_cast<int>(edges.size()); x++)
+        {
+            if(!inTree[x])
+                remainingEdges.push_back(x);
+        }
 
-    int minDistToBorder = dungeon.minDoorDistToCorner;
+        auto rnd = random(GeneratorStats::EDGES);
+
+        std::pmr::vector<int> graphEdges(treeEdges, context.scratch());
+        for(int x = 0; x < dungeon.additionalEdge && remainingEdges.size();  x++)
+        {
+            auto edge = remainingEdges.begin() + rnd.uniform(0, remainingEdges.size() - 1);
+            graphEdges.push_back(*edge);
+            remainingEdges.erase(edge);
+        }
+
+        roomEdges.clear();
+        for(int edge : graphEdges)
+            roomEdges.push_back(edges[edge]);
+    }
 
-    for(auto edge : roomEdges)
+    void buildCorridors(const Dungeon& dungeon)
     {
-        if(rnd(0, 1))
-            std::swap(edge.first, edge.second);
+        map = roomMap;
+        corridors.clear();
+        corridorEdges.clear();
 
-        auto& r1 = placedRoom[edge.first];
-        auto& r2 = placedRoom[edge.second];
+        for(auto& room : rooms)
+            room.doors = {};
 
-        if(r1.pos.x + r1.size.x > r2.pos.x && r2.pos.x + r2.size.x > r1.pos.x)
+        auto& placedRoom = rooms;
+
+        int minDistToBorder = dungeon.minDoorDistToCorner;
+
+        for(int index = 0; index < static_cast<int>(roomEdges.size()); index++)
         {
-            auto min = std::max(r1.pos.x, r2.pos.x);
-            auto max = std::min(r1.pos.x + r1.size.x, r2.pos.x + r2.size.x) - 1;
+            auto edge = roomEdges[index];
+            auto rnd = random(GeneratorStats::CORRIDORS, index);
 
-            auto pos = max;
+            if(rnd.uniform(0, 1))
+                std::swap(edge.first, edge.second);
 
-            min += minDistToBorder;
-            max -= minDistToBorder;
+            auto& r1 = placedRoom[edge.first];
+            auto& r2 = placedRoom[edge.second];
 
-            if(min <= max)
+            if(r1.pos.x + r1.size.x > r2.pos.x && r2.pos.x + r2.size.x > r1.pos.x)
             {
-                pos = rnd(min, max);
+                auto min = std::max(r1.pos.x, r2.pos.x);
+                auto max = std::min(r1.pos.x + r1.size.x, r2.pos.x + r2.size.x) - 1;
 
-                placeRoom(sf::Vector2i(pos, r1.pos.y), sf::Vector2i(1, r2.pos.y - r1.pos.y));
-                dungeon.corridors.push_back({sf::Vector2i(pos, r1.pos.y + r1.size.y * (r1.pos.y < r2.pos.y)), sf::Vector2i(pos + 1, r2.pos.y + r2.size.y * !(r1.pos.y < r2.pos.y))});
+                auto pos = max;
 
-                continue;
+                min += minDistToBorder;
+                max -= minDistToBorder;
+
+                if(min <= max)
+                {
+                    pos = rnd.uniform(min, max);
+
+                    carve(map, Vec2i(pos, r1.pos.y), Vec2i(1, r2.pos.y - r1.pos.y));
+                    corridors.push_back({Vec2i(pos, r1.pos.y + r1.size.y * (r1.pos.y < r2.pos.y)), Vec2i(pos + 1, r2.pos.y + r2.size.y * !(r1.pos.y < r2.pos.y))});
+                    corridorEdges.push_back(index);
+
+                    continue;
+                }
             }
-        }
-        else if(r1.pos.y + r1.size.y > r2.pos.y && r2.pos.y + r2.size.y > r1.pos.y)
-        {
-            auto min = std::max(r1.pos.y, r2.pos.y);
-            auto max = std::min(r1.pos.y + r1.size.y, r2.pos.y + r2.size.y) - 1;
+            else if(r1.pos.y + r1.size.y > r2.pos.y && r2.pos.y + r2.size.y > r1.pos.y)
+            {
+                auto min = std::max(r1.pos.y, r2.pos.y);
+                auto max = std::min(r1.pos.y + r1.size.y, r2.pos.y + r2.size.y) - 1;
+
+                auto pos = max;
 
-            auto pos = max;
+                min += minDistToBorder;
+                max -= minDistToBorder;
+
+                if(min <= max)
+                {
+                    pos = rnd.uniform(min, max);
+
+                    carve(map, Vec2i(r1.pos.x, pos), Vec2i(r2.pos.x - r1.pos.x, 1));
+                    corridors.push_back({Vec2i(r1.pos.x + r1.size.x * (r1.pos.x < r2.pos.x), pos), Vec2i(r2.pos.x + r2.size.x * (r2.pos.x < r1.pos.x), pos + 1)});
+                    corridorEdges.push_back(index);
+
+                    continue;
+                }
+            }
 
-            min += minDistToBorder;
-            max -= minDistToBorder;
+            Vec2i start = {};
+            Vec2i end = {};
+            Dungeon::Room::Side side;
 
-            if(min <= max)
+            if(r1.pos.x > r2.pos.x)
             {
-                pos = rnd(min, max);
+                start.x = r1.pos.x;
+                side = Dungeon::Room::LEFT;
+            }
+            else
+            {
+                start.x = r1.pos.x + r1.size.x;
+                side = Dungeon::Room::RIGHT;
+            }
 
-                placeRoom(sf::Vector2i(r1.pos.x, pos), sf::Vector2i(r2.pos.x - r1.pos.x, 1));
-                dungeon.corridors.push_back({sf::Vector2i(r1.pos.x + r1.size.x * (r1.pos.x < r2.pos.x), pos), sf::Vector2i(r2.pos.x + r2.size.x * (r2.pos.x < r1.pos.x), pos + 1)});
+            if(start.y == r1.doors[side].y)
+                r1.doors[side].y = r1.pos.y + rnd.uniform(minDistToBorder, r1.size.y - minDistToBorder * 2);
 
-                continue;
+            start.y = r1.doors[side].y;
+
+            if(r2.pos.y > r1.pos.y)
+            {
+                end.y = r2.pos.y;
+                side = Dungeon::Room::UP;
+            }
+            else
+            {
+                end.y = r2.pos.y + r2.size.y;
+                side = Dungeon::Room::DOWN;
             }
-        }
 
-        sf::Vector2i start = {};
-        sf::Vector2i end = {};
-        Dungeon::Room::Side side;
+            if(r2.doors[side].x == 0)
+                r2.doors[side].x = r2.pos.x + rnd.uniform(minDistToBorder, r2.size.x - minDistToBorder * 2);
 
-        if(r1.pos.x > r2.pos.x)
-        {
-            start.x = r1.pos.x;
-            side = Dungeon::Room::LEFT;
+            end.x = r2.doors[side].x;
+
+            Vec2i corridor1 = {end.x - start.x, 1};
+            Vec2i corridor2 = {1, start.y - end.y};
+
+            if(corridor2.y > 0)
+                corridor2.y++;
+
+            carve(map, start, corridor1);
+            carve(map, end, corridor2);
+
+            corridors.push_back({start, start + corridor1});
+            corridors.push_back({end, end + corridor2});
+            corridorEdges.insert(corridorEdges.end(), 2, index);
         }
-        else
+    }
+
+    void buildTiles()
+    {
+        const auto size = map.getSize();
+
+        tiles.setSize(size);
+        std::fill(tiles.tiles.begin(), tiles.tiles.end(), Dungeon::EMPTY);
+
+        for(int y = 0; y < size.y; y++)
         {
-            start.x = r1.pos.x + r1.size.x;
-            side = Dungeon::Room::RIGHT;
+            map.forEachSpan(y, [&](int begin, int end)
+            {
+                tiles.fillRect({begin, y}, {end - begin, 1}, Dungeon::CORRIDOR);
+            });
         }
 
-        if(start.y == r1.doors[side].y)
-            r1.doors[side].y = r1.pos.y + rnd(minDistToBorder, r1.size.y - minDistToBorder * 2);
+        for(const auto& room : rooms)
+            tiles.fillRect(room.pos, room.size, Dungeon::ROOM);
 
-        start.y = r1.doors[side].y;
+        auto isRoom = [&](const Vec2i& pos)
+        {
+            return pos.x >= 0 && pos.y >= 0 && pos.x < size.x && pos.y < size.y && tiles.getTile(pos) == Dungeon::ROOM;
+        };
 
-        if(r2.pos.y > r1.pos.y)
+        // doors are where a corridor runs into a room, not where it runs along one
+        for(const auto& corridor : corridors)
         {
-            end.y = r2.pos.y;
-            side = Dungeon::Room::UP;
+            const Vec2i start = {std::max(std::min(corridor.start.x, corridor.end.x), 0), std::max(std::min(corridor.start.y, corridor.end.y), 0)};
+            const Vec2i end = {std::min(std::max(corridor.start.x, corridor.end.x), size.x), std::min(std::max(corridor.start.y, corridor.end.y), size.y)};
+
+            const bool horizontal = end.x - start.x > 1 || end.y - start.y == 1;
+            const bool vertical = end.y - start.y > 1 || end.x - start.x == 1;
+
+            for(int y = start.y; y < end.y; y++)
+            {
+                for(int x = start.x; x < end.x; x++)
+                {
+                    auto& tile = tiles.at({x, y});
+                    if(tile != Dungeon::CORRIDOR)
+                        continue;
+
+                    if((horizontal && (isRoom({x - 1, y}) || isRoom({x + 1, y}))) || (vertical && (isRoom({x, y - 1}) || isRoom({x, y + 1}))))
+                        tile = Dungeon::DOOR;
+                }
+            }
         }
-        else
+
+        for(int y = 0; y < size.y; y++)
         {
-            end.y = r2.pos.y + r2.size.y;
-            side = Dungeon::Room::DOWN;
+            map.forEachSpan(y, [&](int begin, int end)
+            {
+                for(int wallY = std::max(y - 1, 0); wallY <= std::min(y + 1, size.y - 1); wallY++)
+                {
+                    for(int x = std::max(begin - 1, 0); x <= std::min(end, size.x - 1); x++)
+                    {
+                        auto& tile = tiles.at({x, wallY});
+                        if(tile == Dungeon::EMPTY)
+                            tile = Dungeon::WALL;
+                    }
+                }
+            });
         }
+    }
 
-        if(r2.doors[side].x == 0)
-            r2.doors[side].x = r2.pos.x + rnd(minDistToBorder, r2.size.x - minDistToBorder * 2);
+    GeneratorContext context;
+    GeneratorStats stats;
 
-        end.x = r2.doors[side].x;
+    DungeonQuality quality;
+    RejectionStats rejections;
 
-        sf::Vector2i corridor1 = {end.x - start.x, 1};
-        sf::Vector2i corridor2 = {1, start.y - end.y};
+    GenerationProgress* progress = nullptr;
+    bool generated = false;
 
-        if(corridor2.y > 0)
-            corridor2.y++;
+    ThreadPool* pool = nullptr;
 
-        placeRoom(start, corridor1);
-        placeRoom(end, corridor2);
+    std::array<int, 4> sizesKey = {};
+    std::array<int, 5> placementKey = {};
+    std::array<int, 1> treeKey = {};
+    std::array<int, 1> edgesKey = {};
+    std::array<int, 1> corridorsKey = {};
+    std::array<int, 1> navigationKey = {};
 
-        dungeon.corridors.push_back({start, start + corridor1});
-        dungeon.corridors.push_back({end, end + corridor2});
-    }
-//    exit(0);
+    // every stage derives its random streams from it
+    std::uint64_t seed = 0;
+
+    std::pmr::vector<Vec2i> roomSizePool{context.persistent()};
+
+    TileMap<bool> roomMap{context.persistent()};
+    SummedAreaTable occupancy{context.persistent()};
+    PlacementFrontier frontier{context.persistent()};
+
+    // one per direction, the sequential scan only uses the first
+    std::array<PlacementScan, 4> scans{PlacementScan(context.persistent()), PlacementScan(context.persistent()), PlacementScan(context.persistent()), PlacementScan(context.persistent())};
+
+    // positions found by each task of a parallel scan wave, a row of the map each
+    std::pmr::vector<int> waveFound{context.persistent()};
+    std::pmr::vector<ScanCounts> waveCounts{context.persistent()}; // only filled when DUNGEON_STATS is enabled
+    std::pmr::vector<Vec2i> wavePositions{context.persistent()};
+    std::pmr::vector<Dungeon::Room> rooms{context.persistent()};
+
+    std::pmr::vector<Vec2i> roomPos{context.persistent()};
+    Triangulator triangulator{context.persistent()};
+
+    std::pmr::vector<int> treeEdges{context.persistent()};
+    std::pmr::vector<std::pair<int, int>> roomEdges{context.persistent()};
+
+    TileMap<bool> map{context.persistent()};
+    std::pmr::vector<Dungeon::Corridor> corridors{context.persistent()};
+    std::pmr::vector<int> corridorEdges{context.persistent()}; // the room edge of every corridor
+    int roomCrossings = 0;
+    int corridorOverlaps = 0;
+    TileMap<Dungeon::Tile> tiles{context.persistent()};
+    SpatialIndex index{context.persistent()};
+    DungeonNavigation navigation{context.persistent()};
+};
+
+inline void generateDungeon(Dungeon& dungeon)
+{
+    DungeonGenerator generator;
+    generator.generate(dungeon);
 }
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+#include "dungeonGenerator.hpp"
+#include "generatorContext.hpp"
+
+// Generator parameters fixed at compile time, checked by the compiler. They size the memory
+// PresetGenerator keeps its generator in, the generation itself is the one of DungeonGenerator
+// with the parameters copied in a Dungeon: same code, same speed, nothing is specialized on them.
+// Parameters only known at runtime go through DungeonGenerator as usual
+template <int Width, int Height, int RoomSizeMin = 3, int RoomSizeMax = 6, int RoomPoolSize = 50, int AdditionalEdge = 3>
+struct DungeonPreset
+{
+    static_assert(Width > 0 && Height > 0, "the map can't be empty");
+    static_assert(RoomSizeMin > 0 && RoomSizeMin <= RoomSizeMax, "invalid room size range");
+    static_assert(RoomSizeMax < Width && RoomSizeMax < Height, "the rooms must fit in the map");
+    static_assert(RoomPoolSize >= 0 && AdditionalEdge >= 0, "negative counts");
+
+    static Dungeon make(int seed)
+    {
+        Dungeon dungeon;
+        dungeon.seed = seed;
+        dungeon.size = {Width, Height};
+        dungeon.roomSizeMin = RoomSizeMin;
+        dungeon.roomSizeMax = RoomSizeMax;
+        dungeon.roomPoolSize = RoomPoolSize;
+        dungeon.additionalEdge = AdditionalEdge;
+        return dungeon;
+    }
+
+    // the room map and the carved map, in the TileMap<bool> layout
+    static constexpr std::size_t bitmapBytes = std::size_t(((Width + 63) / 64 + 3) / 4 * 4) * 8 * Height;
+
+    // the maps a generator keeps: the two bitmaps, the occupancy sums and the tile kinds
+    static constexpr std::size_t mapBytes = bitmapBytes * 2 + std::size_t(Width + 1) * (Height + 1) * 4 + std::size_t(Width) * Height;
+
+    // What a generator allocates until it's warmed up: the maps, the room and edge lists that
+    // grow a few times and the first block of the scratch arena. Past it memory comes from the heap
+    static constexpr std::size_t memory = mapBytes * 2 + std::size_t(RoomPoolSize) * 1024 + 96 * 1024;
+};
+
+// the parameters Dungeon defaults to
+using DefaultDungeonPreset = DungeonPreset<50, 50>;
+
+// A DungeonGenerator for one preset with its memory inline, its maps, lists and scratch don't
+// touch the heap once it's warmed up. The Dungeon it fills holds std::vectors on the heap, they keep their
+// capacity so only the first calls and the ones with more rooms than before allocate.
+// It's Preset::memory bytes big, keep it around (static, thread_local or a member)
+// rather than on a small stack
+template <typename Preset>
+class PresetGenerator
+{
+public:
+    PresetGenerator() = default;
+
+    PresetGenerator(const PresetGenerator&) = delete;
+    PresetGenerator& operator=(const PresetGenerator&) = delete;
+
+    // the dungeon of seed, it's overwritten by the next call
+    const Dungeon& generate(int seed)
+    {
+        dungeon.seed = seed;
+        generator.generate(dungeon);
+        return dungeon;
+    }
+
+    const DungeonGenerator& getGenerator() const
+    {
+        return generator;
+    }
+
+    // allocations of the generator that didn't fit in Preset::memory and went to the heap,
+    // the ones of the Dungeon aren't counted
+    std::size_t getOverflowCount() const
+    {
+        return overflow.getAllocationCount();
+    }
+
+private:
+    alignas(std::max_align_t) std::byte buffer[Preset::memory];
+
+    CountingResource overflow;
+    std::pmr::monotonic_buffer_resource resource{buffer, sizeof(buffer), &overflow};
+
+    DungeonGenerator generator{&resource};
+    Dungeon dungeon = Preset::make(0);
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <memory_resource>
+
+// What a dungeon must have to be kept. The generator checks each criterion as soon as the
+// stage it depends on is done and stops there when one fails, saving the stages after it.
+// 0 disables a criterion
+struct AcceptanceCriteria
+{
+    int minRooms = 0;         // rooms placed, checked after the placement
+    float minCoverage = 0;    // tiles in rooms over the tiles of the map, after the placement
+
+    int minLoops = 0;         // edges beyond the spanning tree, after the additional edges
+    int minDiameter = 0;      // most rooms to cross between two rooms, after the additional edges
+    int maxDiameter = 0;
+
+    bool noRoomCrossings = false; // no corridor running through a room it doesn't join, after the corridors
+
+    bool isEnabled() const
+    {
+        return minRooms || minCoverage > 0 || minLoops || minDiameter || maxDiameter || noRoomCrossings;
+    }
+};
+
+// The measures of the last dungeon, -1 for the ones not measured because it was rejected before
+struct DungeonQuality
+{
+    enum Rejection {ACCEPTED, TOO_FEW_ROOMS, LOW_COVERAGE, TOO_FEW_LOOPS, DIAMETER, ROOM_CROSSINGS, REJECTION_COUNT};
+
+    static const char* getRejectionName(int rejection)
+    {
+        static const char* names[REJECTION_COUNT] = {"accepted", "tooFewRooms", "lowCoverage", "tooFewLoops", "diameter", "roomCrossings"};
+        return names[rejection];
+    }
+
+    Rejection rejection = ACCEPTED;
+
+    int rooms = -1;
+    float coverage = -1;
+    int loops = -1;
+    int diameter = -1;
+
+    int roomCrossings = -1;    // corridor and room pairs, the corridor running through a room it doesn't join
+    int corridorOverlaps = -1; // pairs of corridors of different edges sharing tiles, like the ones out of a same door
+};
+
+// How many dungeons a generator kept and rejected, by reason, since it was created
+struct RejectionStats
+{
+    std::array<std::uint64_t, DungeonQuality::REJECTION_COUNT> counts = {};
+
+    void add(DungeonQuality::Rejection rejection)
+    {
+        counts[rejection]++;
+    }
+
+    void add(const RejectionStats& other)
+    {
+        for(int x = 0; x < DungeonQuality::REJECTION_COUNT; x++)
+            counts[x] += other.counts[x];
+    }
+
+    std::uint64_t getRejected() const
+    {
+        std::uint64_t rejected = 0;
+        for(int x = DungeonQuality::ACCEPTED + 1; x < DungeonQuality::REJECTION_COUNT; x++)
+            rejected += counts[x];
+
+        return rejected;
+    }
+
+    std::string toJson() const
+    {
+        std::string json = "{";
+        for(int x = 0; x < DungeonQuality::REJECTION_COUNT; x++)
+        {
+            json += x ? ",\"" : "\"";
+            json += DungeonQuality::getRejectionName(x);
+            json += "\":" + std::to_string(counts[x]);
+        }
+
+        json += "}";
+        return json;
+    }
+};
+
+// Longest of the shortest paths between two rooms, in edges, with a breadth first search from
+// every room. Stops as soon as it's known to be more than stopAbove (0 to never stop), the
+// result is then stopAbove + 1. Rooms that can't reach each other don't count
+template <typename Edges>
+int roomGraphDiameter(int roomCount, const Edges& edges, int stopAbove, std::pmr::memory_resource* scratch)
+{
+    // the links of room r are links[linkStart[r], linkStart[r + 1])
+    std::pmr::vector<int> linkStart(roomCount + 1, 0, scratch);
+    for(const auto& edge : edges)
+    {
+        linkStart[edge.first + 1]++;
+        linkStart[edge.second + 1]++;
+    }
+
+    for(int room = 0; room < roomCount; room++)
+        linkStart[room + 1] += linkStart[room];
+
+    std::pmr::vector<int> links(linkStart.back(), scratch);
+    std::pmr::vector<int> cursor(linkStart.begin(), linkStart.end() - 1, scratch);
+    for(const auto& edge : edges)
+    {
+        links[cursor[edge.first]++] = edge.second;
+        links[cursor[edge.second]++] = edge.first;
+    }
+
+    std::pmr::vector<int> distances(roomCount, -1, scratch);
+    std::pmr::vector<int> queue(scratch);
+    queue.reserve(roomCount);
+
+    int diameter = 0;
+    for(int source = 0; source < roomCount; source++)
+    {
+        std::fill(distances.begin(), distances.end(), -1);
+        queue.clear();
+
+        distances[source] = 0;
+        queue.push_back(source);
+
+        for(std::size_t read = 0; read < queue.size(); read++)
+        {
+            const int room = queue[read];
+            for(int link = linkStart[room]; link < linkStart[room + 1]; link++)
+            {
+                const int next = links[link];
+                if(distances[next] != -1)
+                    continue;
+
+                distances[next] = distances[room] + 1;
+                diameter = std::max(diameter, distances[next]);
+                queue.push_back(next);
+
+                if(stopAbove && diameter > stopAbove)
+                    return diameter;
+            }
+        }
+    }
+
+    return diameter;
+}
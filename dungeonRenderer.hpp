@@ -0,0 +1,207 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <algorithm>
+
+#include <SFML/Graphics.hpp>
+
+#include "sfmlAdapter.hpp"
+#include "dungeonGenerator.hpp"
+
+// Draw a dungeon with a vertex array per layer, built once by build() when the
+// dungeon changes and drawn in one call per visible layer.
+// Positions are in pixels, tileSize pixels per tile
+class DungeonRenderer : public sf::Drawable
+{
+public:
+    // in drawing order
+    enum Layer {WALLS, ROOMS, CENTERS, EDGES, CORRIDORS, LAYER_COUNT};
+
+    explicit DungeonRenderer(float tileSize = 10.f) : tileSize(tileSize)
+    {
+        layers[WALLS].setPrimitiveType(sf::Quads);
+        layers[ROOMS].setPrimitiveType(sf::Quads);
+        layers[CORRIDORS].setPrimitiveType(sf::Quads);
+        layers[EDGES].setPrimitiveType(sf::Lines);
+        layers[CENTERS].setPrimitiveType(sf::Triangles);
+
+        visible.fill(true);
+        visible[WALLS] = false;
+    }
+
+    static const char* getLayerName(int layer)
+    {
+        static const char* names[LAYER_COUNT] = {"Walls", "Rooms", "Centers", "Edges", "Corridors"};
+        return names[layer];
+    }
+
+    void build(const Dungeon& dungeon)
+    {
+        for(auto& layer : layers)
+            layer.clear();
+
+        const auto mapSize = dungeon.tiles.getSize();
+        for(int y = 0; y < mapSize.y; y++)
+        {
+            dungeon.tiles.forEachRun(y, [&](int begin, int end, Dungeon::Tile tile)
+            {
+                if(tile == Dungeon::WALL)
+                    addRect(layers[WALLS], toPixels(Vec2i(begin, y)), toPixels(Vec2i(end, y + 1)), sf::Color(90, 90, 90));
+            });
+        }
+
+        for(const auto& room : dungeon.rooms)
+            addRect(layers[ROOMS], toPixels(room.pos), toPixels(room.pos + room.size), sf::Color::White);
+
+        for(const auto& corridor : dungeon.corridors)
+            addRect(layers[CORRIDORS], toPixels(corridor.start), toPixels(corridor.end), sf::Color::Green);
+
+        for(const auto& edge : dungeon.edges)
+        {
+            layers[EDGES].append({toPixels(edge.p1), sf::Color::Yellow});
+            layers[EDGES].append({toPixels(edge.p2), sf::Color::Yellow});
+        }
+
+        // a small disc a bit after the top left corner of the center tile
+        const float radius = tileSize * 0.3f;
+        const int segments = 8;
+        for(const auto& room : dungeon.rooms)
+        {
+            const auto center = toPixels(room.pos + room.size/2) + sf::Vector2f(tileSize * 0.05f, tileSize * 0.05f);
+
+            for(int x = 0; x < segments; x++)
+            {
+                const float angle1 = x * 2 * 3.14159265f / segments;
+                const float angle2 = (x + 1) * 2 * 3.14159265f / segments;
+
+                layers[CENTERS].append({center, sf::Color::Blue});
+                layers[CENTERS].append({center + sf::Vector2f(std::cos(angle1), std::sin(angle1)) * radius, sf::Color::Blue});
+                layers[CENTERS].append({center + sf::Vector2f(std::cos(angle2), std::sin(angle2)) * radius, sf::Color::Blue});
+            }
+        }
+
+        size = toPixels(mapSize);
+    }
+
+    void setVisible(Layer layer, bool visible)
+    {
+        this->visible[layer] = visible;
+    }
+
+    bool isVisible(Layer layer) const
+    {
+        return visible[layer];
+    }
+
+    std::size_t getVertexCount() const
+    {
+        std::size_t count = 0;
+        for(const auto& layer : layers)
+            count += layer.getVertexCount();
+
+        return count;
+    }
+
+    // size of the map in pixels
+    sf::Vector2f getSize() const
+    {
+        return size;
+    }
+
+private:
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override
+    {
+        for(int layer = 0; layer < LAYER_COUNT; layer++)
+        {
+            if(visible[layer])
+                target.draw(layers[layer], states);
+        }
+    }
+
+    sf::Vector2f toPixels(const Vec2i& pos) const
+    {
+        return toSfmlFloat(pos) * tileSize;
+    }
+
+    static void addRect(sf::VertexArray& layer, const sf::Vector2f& start, const sf::Vector2f& end, const sf::Color& color)
+    {
+        layer.append({start, color});
+        layer.append({{end.x, start.y}, color});
+        layer.append({end, color});
+        layer.append({{start.x, end.y}, color});
+    }
+
+    float tileSize;
+    sf::Vector2f size;
+
+    std::array<sf::VertexArray, LAYER_COUNT> layers;
+    std::array<bool, LAYER_COUNT> visible;
+};
+
+// Zoom with the mouse wheel around the cursor and pan by dragging with the right or middle button
+class ViewController
+{
+public:
+    explicit ViewController(const sf::View& view) : view(view)
+    {
+    }
+
+    const sf::View& getView() const
+    {
+        return view;
+    }
+
+    // show the whole rect in the window
+    void fit(const sf::RenderTarget& target, const sf::Vector2f& size)
+    {
+        const sf::Vector2f windowSize(target.getSize());
+        const float scale = std::max(size.x / windowSize.x, size.y / windowSize.y);
+
+        view.setSize(windowSize * (scale > 0 ? scale : 1.f));
+        view.setCenter(size / 2.f);
+        zoom = scale > 0 ? scale : 1.f;
+    }
+
+    // mouseCaptured if the GUI uses the mouse, the events are then ignored
+    void handleEvent(const sf::Event& event, const sf::RenderTarget& target, bool mouseCaptured)
+    {
+        if(event.type == sf::Event::Resized)
+        {
+            view.setSize(sf::Vector2f(event.size.width, event.size.height) * zoom);
+        }
+        else if(event.type == sf::Event::MouseWheelScrolled && !mouseCaptured)
+        {
+            const sf::Vector2i mouse(event.mouseWheelScroll.x, event.mouseWheelScroll.y);
+            const auto before = target.mapPixelToCoords(mouse, view);
+
+            const float factor = event.mouseWheelScroll.delta > 0 ? 1.f / 1.2f : 1.2f;
+            view.zoom(factor);
+            zoom *= factor;
+
+            view.move(before - target.mapPixelToCoords(mouse, view));
+        }
+        else if(event.type == sf::Event::MouseButtonPressed && !mouseCaptured && event.mouseButton.button != sf::Mouse::Left)
+        {
+            dragging = true;
+            lastMouse = {event.mouseButton.x, event.mouseButton.y};
+        }
+        else if(event.type == sf::Event::MouseButtonReleased && event.mouseButton.button != sf::Mouse::Left)
+        {
+            dragging = false;
+        }
+        else if(event.type == sf::Event::MouseMoved && dragging)
+        {
+            const sf::Vector2i mouse(event.mouseMove.x, event.mouseMove.y);
+            view.move(target.mapPixelToCoords(lastMouse, view) - target.mapPixelToCoords(mouse, view));
+            lastMouse = mouse;
+        }
+    }
+
+private:
+    sf::View view;
+    float zoom = 1.f;
+
+    bool dragging = false;
+    sf::Vector2i lastMouse;
+};
@@ -0,0 +1,2260 @@
+// Differential fuzzing of the generator. Random point sets, graphs and dungeon parameters,
+// degenerate ones included (duplicated, collinear and cocircular points, maps where the rooms
+// line up), go through straightforward reference implementations and through the ones the
+// generator runs, on every core. The first case where they differ is shrunk to a smaller one
+// still differing and printed as a repro. --record keeps a hash of every dungeon so --verify
+// can tell, after a change, that every seed still gives the same dungeon.
+
+#include "dungeonGenerator.hpp"
+#include "chunkedWorld.hpp"
+#include "dungeonFile.hpp"
+#include "dungeonPreset.hpp"
+#include "threadPool.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <utility>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+
+namespace
+{
+    enum Check {TRIANGULATION, SPANNING_TREE, DUNGEON, CHUNK, DUNGEON_FILE, KERNELS, PRESET, CHECK_COUNT};
+
+    const char* checkNames[CHECK_COUNT] = {"triangulation", "spanningTree", "dungeon", "chunk", "file", "kernels", "preset"};
+
+    struct Options
+    {
+        std::array<bool, CHECK_COUNT> checks = {true, true, true, true, true, true, true};
+
+        std::uint64_t seed = 0;
+        int caseCount = 100000;
+        int threads = 0;
+        int maxPoints = 24;
+
+        const char* record = nullptr;
+        const char* verify = nullptr;
+    };
+
+    void printUsage()
+    {
+        std::cerr <<
+            "usage: fuzz [options]\n"
+            "  --checks NAME,...             triangulation, spanningTree, dungeon, chunk, file, kernels and preset (all)\n"
+            "  --cases N                     cases per check (100000)\n"
+            "  --seed N                      seed the cases are drawn from (0)\n"
+            "  --threads N                   worker threads, 0 for one per core (0)\n"
+            "  --max-points N                most points in a triangulation or spanning tree case (24)\n"
+            "  --record FILE                 write the hash of every dungeon to FILE\n"
+            "  --verify FILE                 check the dungeons against a recorded FILE, its seed and cases\n";
+    }
+
+    bool parseInt(const char* text, int& value)
+    {
+        char* end;
+        value = std::strtol(text, &end, 10);
+        return *text && *end == '\0';
+    }
+
+    bool parseChecks(const char* text, std::array<bool, CHECK_COUNT>& checks)
+    {
+        checks = {};
+
+        std::string items = text;
+        std::size_t start = 0;
+        while(start <= items.size())
+        {
+            std::size_t end = items.find(',', start);
+            if(end == std::string::npos)
+                end = items.size();
+
+            const auto name = items.substr(start, end - start);
+            const auto check = std::find_if(std::begin(checkNames), std::end(checkNames), [&](const char* checkName){return name == checkName;});
+            if(check == std::end(checkNames))
+                return false;
+
+            checks[check - std::begin(checkNames)] = true;
+            start = end + 1;
+        }
+
+        return true;
+    }
+
+    bool parseOptions(int argc, char** argv, Options& options)
+    {
+        for(int x = 1; x < argc; x++)
+        {
+            const char* name = argv[x];
+            if(x + 1 == argc)
+                return false;
+
+            const char* value = argv[++x];
+
+            bool valid;
+            if(!std::strcmp(name, "--checks"))
+                valid = parseChecks(value, options.checks);
+            else if(!std::strcmp(name, "--cases"))
+                valid = parseInt(value, options.caseCount);
+            else if(!std::strcmp(name, "--seed"))
+            {
+                char* end;
+                options.seed = std::strtoull(value, &end, 10);
+                valid = *value && *end == '\0';
+            }
+            else if(!std::strcmp(name, "--threads"))
+                valid = parseInt(value, options.threads);
+            else if(!std::strcmp(name, "--max-points"))
+                valid = parseInt(value, options.maxPoints);
+            else if(!std::strcmp(name, "--record"))
+                valid = (options.record = value) != nullptr;
+            else if(!std::strcmp(name, "--verify"))
+                valid = (options.verify = value) != nullptr;
+            else
+                valid = false;
+
+            if(!valid)
+                return false;
+        }
+
+        return options.caseCount >= 0 && options.maxPoints >= 0 && !(options.record && options.verify);
+    }
+
+    std::string toString(const Vec2i& v)
+    {
+        return std::to_string(v.x) + "," + std::to_string(v.y);
+    }
+
+    std::string toString(const std::pair<int, int>& edge)
+    {
+        return std::to_string(edge.first) + "-" + std::to_string(edge.second);
+    }
+
+    // FNV-1a of the values added
+    struct Hash
+    {
+        std::uint64_t value = 0xcbf29ce484222325ull;
+
+        void add(int part)
+        {
+            for(int x = 0; x < 4; x++)
+            {
+                value ^= std::uint32_t(part) >> (x * 8) & 0xff;
+                value *= 0x100000001b3ull;
+            }
+        }
+
+        void add(const Vec2i& v)
+        {
+            add(v.x);
+            add(v.y);
+        }
+    };
+
+    // The obvious and slow way to get what the generator computes, the behavior the
+    // optimized code has to keep
+    namespace reference
+    {
+        std::int64_t orient(const Vec2i& a, const Vec2i& b, const Vec2i& c)
+        {
+            return (std::int64_t(b.x) - a.x) * (std::int64_t(c.y) - a.y) - (std::int64_t(b.y) - a.y) * (std::int64_t(c.x) - a.x);
+        }
+
+        // positive when d is inside the circle through a, b and c, counterclockwise
+        __int128 inCircle(const Vec2i& a, const Vec2i& b, const Vec2i& c, const Vec2i& d)
+        {
+            const __int128 adx = a.x - d.x, ady = a.y - d.y;
+            const __int128 bdx = b.x - d.x, bdy = b.y - d.y;
+            const __int128 cdx = c.x - d.x, cdy = c.y - d.y;
+
+            return (adx*adx + ady*ady) * (bdx*cdy - cdx*bdy)
+                - (bdx*bdx + bdy*bdy) * (adx*cdy - cdx*ady)
+                + (cdx*cdx + cdy*cdy) * (adx*bdy - bdx*ady);
+        }
+
+        // Every triangle with no other point in its circumcircle gives its edges. When points
+        // are on the circle the triangulation isn't unique: strict only has the edges every
+        // Delaunay triangulation has and weak the ones a Delaunay triangulation can have
+        struct Delaunay
+        {
+            std::vector<std::pair<int, int>> strict;
+            std::vector<std::pair<int, int>> weak;
+
+            bool degenerate = false;
+
+            int pointCount = 0;     // distinct points
+            int boundaryCount = 0;  // distinct points on the convex hull, the ones along its sides included
+        };
+
+        // duplicated points are the first of them, like the triangulator merges them
+        Delaunay triangulate(const std::vector<Vec2i>& points)
+        {
+            std::vector<int> unique;
+            for(int x = 0; x < static_cast<int>(points.size()); x++)
+            {
+                if(std::find_if(unique.begin(), unique.end(), [&](int other){return points[other] == points[x];}) == unique.end())
+                    unique.push_back(x);
+            }
+
+            Delaunay result;
+            result.pointCount = unique.size();
+
+            if(unique.size() < 2)
+                return result;
+
+            auto addEdge = [](std::vector<std::pair<int, int>>& edges, int a, int b)
+            {
+                edges.emplace_back(std::min(a, b), std::max(a, b));
+            };
+
+            const bool collinear = std::all_of(unique.begin(), unique.end(), [&](int x){return orient(points[unique[0]], points[unique[1]], points[x]) == 0;});
+            if(collinear)
+            {
+                // a chain along the line
+                auto line = unique;
+                std::sort(line.begin(), line.end(), [&](int a, int b){return points[a].x != points[b].x ? points[a].x < points[b].x : points[a].y < points[b].y;});
+
+                for(std::size_t x = 1; x < line.size(); x++)
+                    addEdge(result.strict, line[x - 1], line[x]);
+
+                std::sort(result.strict.begin(), result.strict.end());
+                result.weak = result.strict;
+                return result;
+            }
+
+            for(std::size_t i = 0; i < unique.size(); i++)
+            {
+                for(std::size_t j = i + 1; j < unique.size(); j++)
+                {
+                    for(std::size_t k = j + 1; k < unique.size(); k++)
+                    {
+                        int a = unique[i], b = unique[j], c = unique[k];
+
+                        const auto side = orient(points[a], points[b], points[c]);
+                        if(side == 0)
+                            continue;
+
+                        if(side < 0)
+                            std::swap(b, c);
+
+                        bool inside = false, on = false;
+                        for(int other : unique)
+                        {
+                            if(other == a || other == b || other == c)
+                                continue;
+
+                            const auto circle = inCircle(points[a], points[b], points[c], points[other]);
+                            inside = inside || circle > 0;
+                            on = on || circle == 0;
+                        }
+
+                        if(inside)
+                            continue;
+
+                        for(auto* edges : {&result.weak, &result.strict})
+                        {
+                            if(edges == &result.strict && on)
+                                break;
+
+                            addEdge(*edges, a, b);
+                            addEdge(*edges, b, c);
+                            addEdge(*edges, c, a);
+                        }
+
+                        result.degenerate = result.degenerate || on;
+                    }
+                }
+            }
+
+            for(auto* edges : {&result.weak, &result.strict})
+            {
+                std::sort(edges->begin(), edges->end());
+                edges->erase(std::unique(edges->begin(), edges->end()), edges->end());
+            }
+
+            // a point is on the hull when a line through it and another point has every point on one side
+            for(int point : unique)
+            {
+                for(int other : unique)
+                {
+                    if(other == point)
+                        continue;
+
+                    bool left = false, right = false;
+                    for(int x : unique)
+                    {
+                        const auto side = orient(points[point], points[other], points[x]);
+                        left = left || side > 0;
+                        right = right || side < 0;
+                    }
+
+                    if(!left || !right)
+                    {
+                        result.boundaryCount++;
+                        break;
+                    }
+                }
+            }
+
+            return result;
+        }
+
+        // Kruskal with the edges sorted by length then index and a plain union-find
+        std::vector<int> spanningTree(const std::vector<Vec2i>& points, const std::vector<std::pair<int, int>>& edges)
+        {
+            std::vector<int> order(edges.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&](int a, int b)
+            {
+                return squaredDist(points[edges[a].first], points[edges[a].second]) < squaredDist(points[edges[b].first], points[edges[b].second]);
+            });
+
+            std::vector<int> parents(points.size());
+            std::iota(parents.begin(), parents.end(), 0);
+
+            std::function<int(int)> find = [&](int x)
+            {
+                return parents[x] == x ? x : find(parents[x]);
+            };
+
+            std::vector<int> tree;
+            for(int edge : order)
+            {
+                const int first = find(edges[edge].first);
+                const int second = find(edges[edge].second);
+
+                if(first == second)
+                    continue;
+
+                parents[first] = second;
+                tree.push_back(edge);
+            }
+
+            return tree;
+        }
+
+        // Prim from the first point not reached yet, every step goes through all the edges for the
+        // shortest one leaving the tree, the first one on a tie. A tree per connected part
+        std::vector<int> primTree(const std::vector<Vec2i>& points, const std::vector<std::pair<int, int>>& edges)
+        {
+            std::vector<bool> reached(points.size(), false);
+            std::vector<int> tree;
+
+            for(std::size_t root = 0; root < points.size(); root++)
+            {
+                if(reached[root])
+                    continue;
+
+                reached[root] = true;
+                while(true)
+                {
+                    int best = -1;
+                    std::int64_t bestLength = 0;
+
+                    for(int edge = 0; edge < static_cast<int>(edges.size()); edge++)
+                    {
+                        if(reached[edges[edge].first] == reached[edges[edge].second])
+                            continue;
+
+                        const std::int64_t length = squaredDist(points[edges[edge].first], points[edges[edge].second]);
+                        if(best == -1 || length < bestLength)
+                        {
+                            best = edge;
+                            bestLength = length;
+                        }
+                    }
+
+                    if(best == -1)
+                        break;
+
+                    reached[edges[best].first] = reached[edges[best].second] = true;
+                    tree.push_back(best);
+                }
+            }
+
+            return tree;
+        }
+
+        // a map of chars, rects with a negative size extend before their pos like in the generator
+        struct Grid
+        {
+            Vec2i size;
+            std::vector<char> cells;
+
+            explicit Grid(const Vec2i& size) : size(size), cells(std::size_t(size.x) * size.y, 0)
+            {
+            }
+
+            static void normalize(Vec2i& pos, Vec2i& rectSize)
+            {
+                if(rectSize.x < 0)
+                {
+                    rectSize.x = -rectSize.x;
+                    pos.x -= rectSize.x;
+                }
+
+                if(rectSize.y < 0)
+                {
+                    rectSize.y = -rectSize.y;
+                    pos.y -= rectSize.y;
+                }
+            }
+
+            bool inside(int x, int y) const
+            {
+                return x >= 0 && y >= 0 && x < size.x && y < size.y;
+            }
+
+            char at(int x, int y) const
+            {
+                return cells[std::size_t(y) * size.x + x];
+            }
+
+            // clipped to the map
+            void fill(Vec2i pos, Vec2i rectSize)
+            {
+                normalize(pos, rectSize);
+
+                for(int y = pos.y; y < pos.y + rectSize.y; y++)
+                {
+                    for(int x = pos.x; x < pos.x + rectSize.x; x++)
+                    {
+                        if(inside(x, y))
+                            cells[std::size_t(y) * size.x + x] = 1;
+                    }
+                }
+            }
+
+            // the rect and the tile past its end are in the map, and the rect has no set tile
+            bool fits(Vec2i pos, Vec2i rectSize) const
+            {
+                normalize(pos, rectSize);
+
+                if(size.x <= pos.x + rectSize.x || size.y <= pos.y + rectSize.y || pos.x < 0 || pos.y < 0)
+                    return false;
+
+                for(int y = pos.y; y < pos.y + rectSize.y; y++)
+                {
+                    for(int x = pos.x; x < pos.x + rectSize.x; x++)
+                    {
+                        if(at(x, y))
+                            return false;
+                    }
+                }
+
+                return true;
+            }
+        };
+
+        // what DungeonQuality measures on the corridors
+        struct CorridorMeasures
+        {
+            int roomCrossings = 0;
+            int corridorOverlaps = 0;
+        };
+
+        bool rectsOverlap(Vec2i posA, Vec2i sizeA, Vec2i posB, Vec2i sizeB)
+        {
+            Grid::normalize(posA, sizeA);
+            Grid::normalize(posB, sizeB);
+
+            return
+                std::max(posA.x, posB.x) < std::min(posA.x + sizeA.x, posB.x + sizeB.x) &&
+                std::max(posA.y, posB.y) < std::min(posA.y + sizeA.y, posB.y + sizeB.y);
+        }
+
+        // The generator written the plain way: every position of every row tested tile by tile
+        // on a grid of chars, the same random draws, corridors and tiles built from scratch.
+        // Above maxExactRooms rooms, or when centers are cocircular and any triangulation is
+        // right, the edges come from the triangulator, which its own check covers. The corridor
+        // measures test every corridor against every room and corridor
+        Dungeon generate(const Dungeon& parameters, Triangulator& triangulator, CorridorMeasures* measures = nullptr)
+        {
+            constexpr int maxExactRooms = 40;
+
+            Dungeon dungeon = parameters;
+            dungeon.rooms.clear();
+            dungeon.corridors.clear();
+            dungeon.edges.clear();
+
+            auto random = [&](GeneratorStats::Stage stage, int index)
+            {
+                return RandomStream(std::uint32_t(parameters.seed), {std::uint32_t(stage), std::uint32_t(index)});
+            };
+
+            std::vector<Vec2i> sizes;
+            for(int x = 0; x < parameters.roomPoolSize; x++)
+            {
+                auto rnd = random(GeneratorStats::SIZES, x);
+
+                const int width = rnd.uniform(parameters.roomSizeMin, parameters.roomSizeMax);
+                const int height = rnd.uniform(parameters.roomSizeMin, parameters.roomSizeMax);
+                sizes.push_back({width, height});
+            }
+
+            const Vec2i mapSize = parameters.size;
+            const int distance = parameters.minimalRoomDistance;
+            const int offset = parameters.minimalDirectionalRoomDistance;
+
+            Grid roomGrid(mapSize);
+            auto place = [&](const Vec2i& pos, const Vec2i& size)
+            {
+                roomGrid.fill(pos, size);
+                dungeon.rooms.push_back({pos, size});
+            };
+
+            // where the room goes for line x of row y, rows counted from the side it's placed from
+            auto tryPosition = [&](int dir, const Vec2i& room, int y, int x, std::vector<Vec2i>& positions)
+            {
+                const bool swapX = dir == Dungeon::Room::LEFT || dir == Dungeon::Room::RIGHT;
+                const bool flip = dir == Dungeon::Room::DOWN || dir == Dungeon::Room::RIGHT;
+
+                const int away = flip ? (swapX ? mapSize.x : mapSize.y) - 1 - y : y;
+                const int sight = flip ? -away : (swapX ? mapSize.x : mapSize.y) - away - 1;
+
+                const Vec2i pos = swapX ? Vec2i(away, x) : Vec2i(x, away);
+                const Vec2i sightSize = swapX ? Vec2i(sight, room.y) : Vec2i(room.x, sight);
+
+                Vec2i shift;
+                if(dir == Dungeon::Room::UP)
+                    shift = {0, offset};
+                else if(dir == Dungeon::Room::DOWN)
+                    shift = {0, -offset};
+                else if(dir == Dungeon::Room::LEFT)
+                    shift = {offset, 0};
+                else
+                    shift = {-offset, 0};
+
+                if(
+                    roomGrid.fits(pos, room) &&
+                    roomGrid.fits(pos + shift - Vec2i(distance, distance), room + Vec2i(distance*2, distance*2)) &&
+                    roomGrid.fits(pos + shift, room) &&
+                    roomGrid.fits(pos, sightSize))
+                    positions.push_back(pos + shift);
+            };
+
+            if(!sizes.empty())
+            {
+                place(mapSize/2, sizes.back());
+                sizes.pop_back();
+            }
+
+            while(!sizes.empty())
+            {
+                const Vec2i room = sizes.back();
+                sizes.pop_back();
+
+                auto rnd = random(GeneratorStats::PLACEMENT, sizes.size());
+                const int originDir = rnd.uniform(Dungeon::Room::UP, Dungeon::Room::RIGHT);
+
+                // the first row with positions of the first side having one
+                std::vector<Vec2i> positions;
+                int tried = 0;
+                for(; tried < 4 && positions.empty(); tried++)
+                {
+                    for(int y = 0; y < mapSize.y && positions.empty(); y++)
+                    {
+                        for(int x = 0; x < mapSize.x; x++)
+                            tryPosition((originDir + tried) % 4, room, y, x, positions);
+                    }
+                }
+
+                if(positions.empty())
+                    break;
+
+                place(positions[rnd.uniform(0, positions.size() - 1)], room);
+
+                if(tried == 4)
+                    break;
+            }
+
+            std::vector<Vec2i> centers;
+            for(const auto& room : dungeon.rooms)
+                centers.push_back(room.pos + room.size/2);
+
+            std::vector<std::pair<int, int>> edges;
+            const auto delaunay = centers.size() <= maxExactRooms ? reference::triangulate(centers) : Delaunay{};
+            if(centers.size() <= maxExactRooms && !delaunay.degenerate)
+                edges = delaunay.strict;
+            else
+            {
+                triangulator.triangulate(centers);
+                for(const auto& edge : triangulator.getEdges())
+                    edges.push_back({edge.first, edge.second});
+            }
+
+            const auto tree = parameters.spanningTree == Dungeon::PRIM ? primTree(centers, edges) : spanningTree(centers, edges);
+
+            std::vector<int> remaining;
+            for(int edge = 0; edge < static_cast<int>(edges.size()); edge++)
+            {
+                if(std::find(tree.begin(), tree.end(), edge) == tree.end())
+                    remaining.push_back(edge);
+            }
+
+            std::vector<std::pair<int, int>> roomEdges;
+            for(int edge : tree)
+                roomEdges.push_back(edges[edge]);
+
+            auto edgeRnd = random(GeneratorStats::EDGES, 0);
+            for(int x = 0; x < parameters.additionalEdge && !remaining.empty(); x++)
+            {
+                const int picked = edgeRnd.uniform(0, remaining.size() - 1);
+                roomEdges.push_back(edges[remaining[picked]]);
+                remaining.erase(remaining.begin() + picked);
+            }
+
+            for(const auto& edge : roomEdges)
+                dungeon.edges.push_back({centers[edge.first], centers[edge.second]});
+
+            Grid carved = roomGrid;
+            const int corner = parameters.minDoorDistToCorner;
+
+            std::vector<int> corridorEdges;
+
+            for(int index = 0; index < static_cast<int>(roomEdges.size()); index++)
+            {
+                auto edge = roomEdges[index];
+                auto rnd = random(GeneratorStats::CORRIDORS, index);
+
+                if(rnd.uniform(0, 1))
+                    std::swap(edge.first, edge.second);
+
+                auto& r1 = dungeon.rooms[edge.first];
+                auto& r2 = dungeon.rooms[edge.second];
+
+                const bool overlapX = r1.pos.x < r2.pos.x + r2.size.x && r2.pos.x < r1.pos.x + r1.size.x;
+                const bool overlapY = r1.pos.y < r2.pos.y + r2.size.y && r2.pos.y < r1.pos.y + r1.size.y;
+
+                // a straight corridor where the rooms face each other far enough from their corners
+                if(overlapX)
+                {
+                    const int first = std::max(r1.pos.x, r2.pos.x) + corner;
+                    const int last = std::min(r1.pos.x + r1.size.x, r2.pos.x + r2.size.x) - 1 - corner;
+
+                    if(first <= last)
+                    {
+                        const int x = rnd.uniform(first, last);
+                        const bool below = r1.pos.y < r2.pos.y;
+
+                        carved.fill({x, r1.pos.y}, {1, r2.pos.y - r1.pos.y});
+                        dungeon.corridors.push_back({{x, below ? r1.pos.y + r1.size.y : r1.pos.y}, {x + 1, below ? r2.pos.y : r2.pos.y + r2.size.y}});
+                        corridorEdges.push_back(index);
+                        continue;
+                    }
+                }
+                else if(overlapY)
+                {
+                    const int first = std::max(r1.pos.y, r2.pos.y) + corner;
+                    const int last = std::min(r1.pos.y + r1.size.y, r2.pos.y + r2.size.y) - 1 - corner;
+
+                    if(first <= last)
+                    {
+                        const int y = rnd.uniform(first, last);
+                        const bool right = r1.pos.x < r2.pos.x;
+
+                        carved.fill({r1.pos.x, y}, {r2.pos.x - r1.pos.x, 1});
+                        dungeon.corridors.push_back({{right ? r1.pos.x + r1.size.x : r1.pos.x, y}, {right ? r2.pos.x : r2.pos.x + r2.size.x, y + 1}});
+                        corridorEdges.push_back(index);
+                        continue;
+                    }
+                }
+
+                // otherwise an L, out of a side door of r1 and into a top or bottom door of r2,
+                // reusing the doors already on those sides
+                const bool leftSide = r1.pos.x > r2.pos.x;
+                auto& door1 = r1.doors[leftSide ? Dungeon::Room::LEFT : Dungeon::Room::RIGHT];
+                if(door1.y == 0)
+                    door1.y = r1.pos.y + rnd.uniform(corner, r1.size.y - corner * 2);
+
+                const Vec2i start = {leftSide ? r1.pos.x : r1.pos.x + r1.size.x, door1.y};
+
+                const bool topSide = r2.pos.y > r1.pos.y;
+                auto& door2 = r2.doors[topSide ? Dungeon::Room::UP : Dungeon::Room::DOWN];
+                if(door2.x == 0)
+                    door2.x = r2.pos.x + rnd.uniform(corner, r2.size.x - corner * 2);
+
+                const Vec2i end = {door2.x, topSide ? r2.pos.y : r2.pos.y + r2.size.y};
+
+                const Vec2i across = {end.x - start.x, 1};
+                const Vec2i down = {1, start.y > end.y ? start.y - end.y + 1 : start.y - end.y};
+
+                carved.fill(start, across);
+                carved.fill(end, down);
+
+                dungeon.corridors.push_back({start, start + across});
+                dungeon.corridors.push_back({end, end + down});
+                corridorEdges.push_back(index);
+                corridorEdges.push_back(index);
+            }
+
+            if(measures)
+            {
+                *measures = {};
+
+                const auto& corridors = dungeon.corridors;
+                for(std::size_t a = 0; a < corridors.size(); a++)
+                {
+                    const auto& edge = roomEdges[corridorEdges[a]];
+                    const Vec2i size = corridors[a].end - corridors[a].start;
+
+                    for(int room = 0; room < static_cast<int>(dungeon.rooms.size()); room++)
+                    {
+                        if(room != edge.first && room != edge.second && rectsOverlap(corridors[a].start, size, dungeon.rooms[room].pos, dungeon.rooms[room].size))
+                            measures->roomCrossings++;
+                    }
+
+                    for(std::size_t b = a + 1; b < corridors.size(); b++)
+                    {
+                        if(corridorEdges[a] != corridorEdges[b] && rectsOverlap(corridors[a].start, size, corridors[b].start, corridors[b].end - corridors[b].start))
+                            measures->corridorOverlaps++;
+                    }
+                }
+            }
+
+            std::vector<Dungeon::Tile> tiles(std::size_t(mapSize.x) * mapSize.y, Dungeon::EMPTY);
+            auto tileAt = [&](int x, int y) -> Dungeon::Tile&
+            {
+                return tiles[std::size_t(y) * mapSize.x + x];
+            };
+
+            for(int y = 0; y < mapSize.y; y++)
+            {
+                for(int x = 0; x < mapSize.x; x++)
+                    tileAt(x, y) = carved.at(x, y) ? Dungeon::CORRIDOR : Dungeon::EMPTY;
+            }
+
+            for(const auto& room : dungeon.rooms)
+            {
+                for(int y = room.pos.y; y < room.pos.y + room.size.y; y++)
+                {
+                    for(int x = room.pos.x; x < room.pos.x + room.size.x; x++)
+                        tileAt(x, y) = Dungeon::ROOM;
+                }
+            }
+
+            auto isRoom = [&](int x, int y)
+            {
+                return carved.inside(x, y) && tileAt(x, y) == Dungeon::ROOM;
+            };
+
+            // a corridor tile next to a room across the corridor's run is a door
+            for(const auto& corridor : dungeon.corridors)
+            {
+                Vec2i pos = corridor.start;
+                Vec2i size = corridor.end - corridor.start;
+                Grid::normalize(pos, size);
+
+                const Vec2i first = {std::max(pos.x, 0), std::max(pos.y, 0)};
+                const Vec2i last = {std::min(pos.x + size.x, mapSize.x), std::min(pos.y + size.y, mapSize.y)};
+
+                const bool horizontal = last.x - first.x > 1 || last.y - first.y == 1;
+                const bool vertical = last.y - first.y > 1 || last.x - first.x == 1;
+
+                for(int y = first.y; y < last.y; y++)
+                {
+                    for(int x = first.x; x < last.x; x++)
+                    {
+                        if(tileAt(x, y) != Dungeon::CORRIDOR)
+                            continue;
+
+                        if((horizontal && (isRoom(x - 1, y) || isRoom(x + 1, y))) || (vertical && (isRoom(x, y - 1) || isRoom(x, y + 1))))
+                            tileAt(x, y) = Dungeon::DOOR;
+                    }
+                }
+            }
+
+            // an empty tile touching a carved one, diagonals included, is a wall
+            for(int y = 0; y < mapSize.y; y++)
+            {
+                for(int x = 0; x < mapSize.x; x++)
+                {
+                    if(tileAt(x, y) != Dungeon::EMPTY)
+                        continue;
+
+                    bool touching = false;
+                    for(int dy = -1; dy <= 1; dy++)
+                    {
+                        for(int dx = -1; dx <= 1; dx++)
+                            touching = touching || (carved.inside(x + dx, y + dy) && carved.at(x + dx, y + dy));
+                    }
+
+                    if(touching)
+                        tileAt(x, y) = Dungeon::WALL;
+                }
+            }
+
+            dungeon.tiles.setSize(mapSize);
+            dungeon.tiles.tiles.assign(tiles.begin(), tiles.end());
+
+            return dungeon;
+        }
+    }
+
+    // Point sets with the degenerate cases the triangulation has to get right
+    std::vector<Vec2i> makePoints(RandomStream& rnd, int maxPoints)
+    {
+        const int count = rnd.uniform(0, maxPoints);
+
+        std::vector<Vec2i> points;
+        auto addLine = [&](int count)
+        {
+            static const Vec2i directions[] = {{1, 0}, {0, 1}, {1, 1}, {2, -1}, {3, 5}};
+            const Vec2i direction = directions[rnd.uniform(0, 4)];
+            const Vec2i origin = {rnd.uniform(-20, 20), rnd.uniform(-20, 20)};
+
+            for(int x = 0; x < count; x++)
+            {
+                const int step = rnd.uniform(0, count * 2);
+                points.push_back(origin + Vec2i(direction.x * step, direction.y * step));
+            }
+        };
+
+        switch(rnd.uniform(0, 5))
+        {
+            case 0: // spread out, rarely degenerate
+                for(int x = 0; x < count; x++)
+                    points.emplace_back(rnd.uniform(0, 4095), rnd.uniform(0, 4095));
+                break;
+            case 1: // crammed, duplicated and cocircular points
+                for(int x = 0; x < count; x++)
+                    points.emplace_back(rnd.uniform(0, 5), rnd.uniform(0, 5));
+                break;
+            case 2: // all on a line
+                addLine(count);
+                break;
+            case 3: // on a line but a few
+                addLine(count);
+                for(int x = rnd.uniform(1, 3); x > 0; x--)
+                    points.emplace_back(rnd.uniform(-20, 60), rnd.uniform(-20, 60));
+                break;
+            case 4: // a lattice, every square is cocircular
+            {
+                const int side = rnd.uniform(1, 6);
+                const int spacing = rnd.uniform(1, 4);
+                for(int x = 0; x < count; x++)
+                    points.emplace_back(x % side * spacing, x / side * spacing);
+
+                std::shuffle(points.begin(), points.end(), rnd);
+                break;
+            }
+            default: // like room centers on the default map
+                for(int x = 0; x < count; x++)
+                    points.emplace_back(rnd.uniform(0, 49), rnd.uniform(0, 49));
+                break;
+        }
+
+        return points;
+    }
+
+    struct Graph
+    {
+        std::vector<Vec2i> points;
+        std::vector<std::pair<int, int>> edges;
+    };
+
+    Graph makeGraph(RandomStream& rnd, int maxPoints)
+    {
+        Graph graph;
+        graph.points = makePoints(rnd, maxPoints);
+
+        const int count = graph.points.size();
+        if(count < 2)
+            return graph;
+
+        if(rnd.uniform(0, 1))
+        {
+            // a triangulation, like the generator gives, sometimes in another order
+            Triangulator triangulator;
+            triangulator.triangulate(graph.points);
+            graph.edges.assign(triangulator.getEdges().begin(), triangulator.getEdges().end());
+
+            if(rnd.uniform(0, 1))
+                std::shuffle(graph.edges.begin(), graph.edges.end(), rnd);
+        }
+        else
+        {
+            // any edges, the graph can be disconnected and have the same edge twice
+            for(int x = rnd.uniform(0, count * 3); x > 0; x--)
+            {
+                const int first = rnd.uniform(0, count - 1);
+                const int second = rnd.uniform(0, count - 2);
+                graph.edges.emplace_back(first, second + (second >= first));
+            }
+        }
+
+        return graph;
+    }
+
+    Dungeon makeDungeon(RandomStream& rnd)
+    {
+        Dungeon dungeon;
+        dungeon.seed = rnd.uniform(0, std::numeric_limits<int>::max());
+
+        // the doors need rooms at least 3 times as big as their distance to the corners
+        dungeon.minDoorDistToCorner = rnd.uniform(0, 2);
+        dungeon.roomSizeMin = rnd.uniform(std::max(1, dungeon.minDoorDistToCorner * 3), std::max(6, dungeon.minDoorDistToCorner * 3));
+        dungeon.roomSizeMax = dungeon.roomSizeMin + rnd.uniform(0, 6);
+
+        // the first room goes in the middle, the map has to be twice as big. Sometimes it's
+        // not bigger than that on one side and the room centers line up
+        const int minSize = dungeon.roomSizeMax * 2 + 1;
+        dungeon.size = {rnd.uniform(minSize, 120), rnd.uniform(minSize, 120)};
+        if(rnd.uniform(0, 7) == 0)
+        {
+            auto& side = rnd.uniform(0, 1) ? dungeon.size.x : dungeon.size.y;
+            side = minSize + rnd.uniform(0, 2);
+        }
+
+        dungeon.roomPoolSize = rnd.uniform(0, 120);
+        dungeon.minimalRoomDistance = rnd.uniform(0, 5);
+        dungeon.minimalDirectionalRoomDistance = rnd.uniform(0, 12);
+        dungeon.additionalEdge = rnd.uniform(0, 10);
+        dungeon.spanningTree = rnd.uniform(0, 1) ? Dungeon::PRIM : Dungeon::KRUSKAL;
+
+        return dungeon;
+    }
+
+    // A chunk of a world whose chunks are generated from settings, sometimes with more rooms
+    // required than fit so they get rejected
+    struct ChunkCase
+    {
+        Dungeon settings;
+        int chunkSize;
+        Vec2i coord;
+    };
+
+    ChunkCase makeChunkCase(RandomStream& rnd)
+    {
+        ChunkCase chunk;
+        chunk.settings = makeDungeon(rnd);
+        chunk.chunkSize = rnd.uniform(chunk.settings.roomSizeMax * 2 + 1, 64);
+        chunk.coord = {rnd.uniform(-1000, 1000), rnd.uniform(-1000, 1000)};
+
+        if(rnd.uniform(0, 3) == 0)
+            chunk.settings.acceptance.minRooms = rnd.uniform(1, 40);
+
+        return chunk;
+    }
+
+    // What differs between a triangulation and the reference, empty if nothing. On cocircular
+    // points the reference only tells what a Delaunay triangulation is, hash is what tells if
+    // the one picked changed
+    std::string checkTriangulation(const std::vector<Vec2i>& points, Triangulator& triangulator, std::uint64_t* hash = nullptr)
+    {
+        const auto expected = reference::triangulate(points);
+
+        triangulator.triangulate(points);
+        const std::vector<std::pair<int, int>> edges(triangulator.getEdges().begin(), triangulator.getEdges().end());
+
+        if(hash)
+        {
+            Hash edgesHash;
+            for(const auto& edge : edges)
+                edgesHash.add({edge.first, edge.second});
+
+            *hash = edgesHash.value;
+        }
+
+        if(!expected.degenerate)
+        {
+            if(edges != expected.strict)
+            {
+                const auto mismatch = std::mismatch(edges.begin(), edges.end(), expected.strict.begin(), expected.strict.end());
+                if(mismatch.second == expected.strict.end())
+                    return "extra edge " + toString(*mismatch.first);
+
+                return "edge " + toString(*mismatch.second) + " missing";
+            }
+        }
+        else
+        {
+            // points on the circles, any Delaunay triangulation will do
+            for(const auto& edge : edges)
+            {
+                if(!std::binary_search(expected.weak.begin(), expected.weak.end(), edge))
+                    return "edge " + toString(edge) + " isn't Delaunay";
+            }
+
+            for(const auto& edge : expected.strict)
+            {
+                if(!std::binary_search(edges.begin(), edges.end(), edge))
+                    return "edge " + toString(edge) + " missing";
+            }
+
+            const int expectedCount = 3 * expected.pointCount - 3 - expected.boundaryCount;
+            if(static_cast<int>(edges.size()) != expectedCount)
+                return std::to_string(edges.size()) + " edges instead of " + std::to_string(expectedCount);
+
+            for(const auto& e1 : edges)
+            {
+                for(const auto& e2 : edges)
+                {
+                    if(e1.first == e2.first || e1.first == e2.second || e1.second == e2.first || e1.second == e2.second)
+                        continue;
+
+                    const auto& a = points[e1.first];
+                    const auto& b = points[e1.second];
+                    const auto& c = points[e2.first];
+                    const auto& d = points[e2.second];
+
+                    if(reference::orient(a, b, c) * reference::orient(a, b, d) < 0 && reference::orient(c, d, a) * reference::orient(c, d, b) < 0)
+                        return "edges " + toString(e1) + " and " + toString(e2) + " cross";
+                }
+            }
+        }
+
+        // triangulate() gives the same edges between the points themselves
+        const auto pointEdges = triangulate(points);
+        if(pointEdges.size() != edges.size())
+            return "triangulate() gives " + std::to_string(pointEdges.size()) + " edges instead of " + std::to_string(edges.size());
+
+        for(std::size_t x = 0; x < edges.size(); x++)
+        {
+            if(pointEdges[x].p1 != points[edges[x].first] || pointEdges[x].p2 != points[edges[x].second])
+                return "triangulate() edge " + std::to_string(x) + " isn't " + toString(edges[x]);
+        }
+
+        return {};
+    }
+
+    // the hash covers the edges Prim keeps on a tie, the reference doesn't tell which it should keep
+    std::string checkSpanningTree(const Graph& graph, std::uint64_t* hash = nullptr)
+    {
+        const auto& points = graph.points;
+        const auto& edges = graph.edges;
+
+        const auto expected = reference::spanningTree(points, edges);
+
+        const auto kruskal = minimumSpanningTree(points, edges);
+        if(!std::equal(kruskal.begin(), kruskal.end(), expected.begin(), expected.end()))
+            return "Kruskal keeps other edges";
+
+        // Prim keeps the same edges when no two have the same length, the same total length anyway
+        const auto prim = primSpanningTree(points, edges);
+
+        if(hash)
+        {
+            Hash treesHash;
+            for(const auto* tree : {&kruskal, &prim})
+            {
+                treesHash.add(static_cast<int>(tree->size()));
+                for(int edge : *tree)
+                    treesHash.add(edge);
+            }
+
+            *hash = treesHash.value;
+        }
+
+        auto totalLength = [&](const auto& tree)
+        {
+            std::int64_t total = 0;
+            for(int edge : tree)
+                total += squaredDist(points[edges[edge].first], points[edges[edge].second]);
+
+            return total;
+        };
+
+        if(prim.size() != expected.size() || totalLength(prim) != totalLength(expected))
+            return "Prim's tree isn't minimal";
+
+        std::vector<std::int64_t> lengths;
+        for(const auto& edge : edges)
+            lengths.push_back(squaredDist(points[edge.first], points[edge.second]));
+
+        std::sort(lengths.begin(), lengths.end());
+        if(std::adjacent_find(lengths.begin(), lengths.end()) == lengths.end())
+        {
+            std::vector<int> sortedPrim(prim.begin(), prim.end());
+            std::vector<int> sortedExpected(expected);
+            std::sort(sortedPrim.begin(), sortedPrim.end());
+            std::sort(sortedExpected.begin(), sortedExpected.end());
+
+            if(sortedPrim != sortedExpected)
+                return "Prim keeps other edges";
+        }
+
+        // the version over positions merges the points at the same place
+        std::vector<Edge> pointEdges;
+        for(const auto& edge : edges)
+            pointEdges.push_back({points[edge.first], points[edge.second]});
+
+        std::vector<Vec2i> nodes;
+        std::vector<std::pair<int, int>> nodeEdges;
+        auto indexOf = [&](const Vec2i& point)
+        {
+            const auto it = std::find(nodes.begin(), nodes.end(), point);
+            if(it != nodes.end())
+                return static_cast<int>(it - nodes.begin());
+
+            nodes.push_back(point);
+            return static_cast<int>(nodes.size() - 1);
+        };
+
+        for(const auto& edge : pointEdges)
+        {
+            const int first = indexOf(edge.p1);
+            nodeEdges.emplace_back(first, indexOf(edge.p2));
+        }
+
+        const auto pointTree = minimumSpanningTree(pointEdges);
+        const auto expectedPointTree = reference::spanningTree(nodes, nodeEdges);
+
+        if(pointTree.size() != expectedPointTree.size())
+            return "minimumSpanningTree() over positions keeps " + std::to_string(pointTree.size()) + " edges instead of " + std::to_string(expectedPointTree.size());
+
+        for(std::size_t x = 0; x < pointTree.size(); x++)
+        {
+            const auto& edge = pointEdges[expectedPointTree[x]];
+            if(pointTree[x].p1 != edge.p1 || pointTree[x].p2 != edge.p2)
+                return "minimumSpanningTree() over positions keeps other edges";
+        }
+
+        return {};
+    }
+
+    std::string compareDungeons(const Dungeon& expected, const Dungeon& dungeon)
+    {
+        if(dungeon.rooms.size() != expected.rooms.size())
+            return std::to_string(dungeon.rooms.size()) + " rooms instead of " + std::to_string(expected.rooms.size());
+
+        for(std::size_t x = 0; x < expected.rooms.size(); x++)
+        {
+            const auto& room = dungeon.rooms[x];
+            const auto& expectedRoom = expected.rooms[x];
+
+            if(room.pos != expectedRoom.pos || room.size != expectedRoom.size)
+                return "room " + std::to_string(x) + " at " + toString(room.pos) + " size " + toString(room.size) + " instead of " + toString(expectedRoom.pos) + " size " + toString(expectedRoom.size);
+
+            if(room.doors != expectedRoom.doors)
+                return "room " + std::to_string(x) + " has other doors";
+        }
+
+        if(dungeon.edges.size() != expected.edges.size())
+            return std::to_string(dungeon.edges.size()) + " edges instead of " + std::to_string(expected.edges.size());
+
+        for(std::size_t x = 0; x < expected.edges.size(); x++)
+        {
+            if(dungeon.edges[x].p1 != expected.edges[x].p1 || dungeon.edges[x].p2 != expected.edges[x].p2)
+                return "edge " + std::to_string(x) + " is " + toString(dungeon.edges[x].p1) + " " + toString(dungeon.edges[x].p2) + " instead of " + toString(expected.edges[x].p1) + " " + toString(expected.edges[x].p2);
+        }
+
+        if(dungeon.corridors.size() != expected.corridors.size())
+            return std::to_string(dungeon.corridors.size()) + " corridors instead of " + std::to_string(expected.corridors.size());
+
+        for(std::size_t x = 0; x < expected.corridors.size(); x++)
+        {
+            if(dungeon.corridors[x].start != expected.corridors[x].start || dungeon.corridors[x].end != expected.corridors[x].end)
+                return "corridor " + std::to_string(x) + " differs";
+        }
+
+        if(dungeon.tiles.tiles != expected.tiles.tiles)
+            return "the tiles differ";
+
+        return {};
+    }
+
+    std::uint64_t hashDungeon(const Dungeon& dungeon)
+    {
+        Hash hash;
+        for(const auto& room : dungeon.rooms)
+        {
+            hash.add(room.pos);
+            hash.add(room.size);
+            for(const auto& door : room.doors)
+                hash.add(door);
+        }
+
+        for(const auto& edge : dungeon.edges)
+        {
+            hash.add(edge.p1);
+            hash.add(edge.p2);
+        }
+
+        for(const auto& corridor : dungeon.corridors)
+        {
+            hash.add(corridor.start);
+            hash.add(corridor.end);
+        }
+
+        for(const auto tile : dungeon.tiles.tiles)
+            hash.add(tile);
+
+        return hash.value;
+    }
+
+    std::string compareChunks(const WorldChunk& expected, const WorldChunk& chunk)
+    {
+        if(chunk.coord != expected.coord || chunk.origin != expected.origin)
+            return "the chunk is at " + toString(chunk.coord) + " instead of " + toString(expected.coord);
+
+        if(chunk.rooms.size() != expected.rooms.size())
+            return std::to_string(chunk.rooms.size()) + " rooms instead of " + std::to_string(expected.rooms.size());
+
+        for(std::size_t x = 0; x < expected.rooms.size(); x++)
+        {
+            if(chunk.rooms[x].pos != expected.rooms[x].pos || chunk.rooms[x].size != expected.rooms[x].size)
+                return "room " + std::to_string(x) + " differs";
+        }
+
+        if(chunk.edges.size() != expected.edges.size())
+            return std::to_string(chunk.edges.size()) + " edges instead of " + std::to_string(expected.edges.size());
+
+        for(std::size_t x = 0; x < expected.edges.size(); x++)
+        {
+            if(chunk.edges[x].p1 != expected.edges[x].p1 || chunk.edges[x].p2 != expected.edges[x].p2)
+                return "edge " + std::to_string(x) + " differs";
+        }
+
+        if(chunk.corridors.size() != expected.corridors.size())
+            return std::to_string(chunk.corridors.size()) + " corridors instead of " + std::to_string(expected.corridors.size());
+
+        for(std::size_t x = 0; x < expected.corridors.size(); x++)
+        {
+            if(chunk.corridors[x].start != expected.corridors[x].start || chunk.corridors[x].end != expected.corridors[x].end)
+                return "corridor " + std::to_string(x) + " differs";
+        }
+
+        if(chunk.portals != expected.portals)
+            return "the portals differ";
+
+        if(chunk.map.getSize() != expected.map.getSize())
+            return "the map is " + toString(chunk.map.getSize()) + " instead of " + toString(expected.map.getSize());
+
+        for(int y = 0; y < expected.map.getSize().y; y++)
+        {
+            for(int x = 0; x < expected.map.getSize().x; x++)
+            {
+                if(chunk.map.getTile({x, y}) != expected.map.getTile({x, y}))
+                    return "tile " + toString(Vec2i(x, y)) + " differs";
+            }
+        }
+
+        return {};
+    }
+
+    // the presets generated besides the default one: a small map with rooms nearly as big and a
+    // wide one with many rooms and loops
+    using SmallPreset = DungeonPreset<16, 12, 3, 5, 40, 0>;
+    using WidePreset = DungeonPreset<150, 60, 4, 10, 120, 6>;
+
+    const char* presetNames[] = {"DefaultDungeonPreset", "DungeonPreset<16, 12, 3, 5, 40, 0>", "DungeonPreset<150, 60, 4, 10, 120, 6>"};
+
+    // What every worker thread keeps from one case to the next
+    struct Worker
+    {
+        Worker()
+        {
+            parallel.setThreadPool(&placementPool);
+        }
+
+        Triangulator triangulator;
+
+        DungeonGenerator cached;
+        ThreadPool placementPool{2};
+        DungeonGenerator parallel;
+
+        // kept from one case to the next, their memory has to last for every seed
+        std::unique_ptr<PresetGenerator<DefaultDungeonPreset>> defaultPreset = std::make_unique<PresetGenerator<DefaultDungeonPreset>>();
+        std::unique_ptr<PresetGenerator<SmallPreset>> smallPreset = std::make_unique<PresetGenerator<SmallPreset>>();
+        std::unique_ptr<PresetGenerator<WidePreset>> widePreset = std::make_unique<PresetGenerator<WidePreset>>();
+    };
+
+    // the results of the generator in dungeon, whether the run had anything to do or not
+    void runGenerator(DungeonGenerator& generator, const Dungeon& parameters, Dungeon& dungeon)
+    {
+        generator.run(parameters);
+
+        dungeon.rooms.assign(generator.getRooms().begin(), generator.getRooms().end());
+        dungeon.corridors.assign(generator.getCorridors().begin(), generator.getCorridors().end());
+
+        const auto& rooms = generator.getRooms();
+        dungeon.edges.clear();
+        for(const auto& edge : generator.getRoomEdges())
+            dungeon.edges.push_back({rooms[edge.first].pos + rooms[edge.first].size/2, rooms[edge.second].pos + rooms[edge.second].size/2});
+
+        dungeon.tiles = generator.getTiles();
+    }
+
+    // The reference is the naive generator, it's compared to the placement testing every
+    // position, to the frontier placement, to a generator reusing cached stages, whose corridor
+    // measures are checked too, and to the placement on a pool
+    std::string checkDungeon(const Dungeon& parameters, Worker& worker, std::uint64_t* hash = nullptr)
+    {
+        reference::CorridorMeasures measures;
+        const Dungeon expected = reference::generate(parameters, worker.triangulator, &measures);
+
+        if(hash)
+            *hash = hashDungeon(expected);
+
+        Dungeon exhaustive = parameters;
+        exhaustive.placement = Dungeon::EXHAUSTIVE;
+        generateDungeon(exhaustive);
+
+        auto difference = compareDungeons(expected, exhaustive);
+        if(!difference.empty())
+            return "exhaustive placement: " + difference;
+
+        Dungeon frontier = parameters;
+        frontier.placement = Dungeon::FRONTIER;
+        generateDungeon(frontier);
+
+        difference = compareDungeons(expected, frontier);
+        if(!difference.empty())
+            return "frontier placement: " + difference;
+
+        // the late stages run again over the cached early ones
+        Dungeon tweaked = frontier;
+        tweaked.additionalEdge++;
+        tweaked.spanningTree = tweaked.spanningTree == Dungeon::PRIM ? Dungeon::KRUSKAL : Dungeon::PRIM;
+
+        Dungeon cached;
+        runGenerator(worker.cached, tweaked, cached);
+        runGenerator(worker.cached, frontier, cached);
+
+        difference = compareDungeons(expected, cached);
+        if(!difference.empty())
+            return "cached stages: " + difference;
+
+        // the measures of the generator come from its spatial index
+        const auto& quality = worker.cached.getQuality();
+        if(quality.roomCrossings != measures.roomCrossings || quality.corridorOverlaps != measures.corridorOverlaps)
+            return "corridor measures: " + std::to_string(quality.roomCrossings) + " room crossings and " + std::to_string(quality.corridorOverlaps) + " corridor overlaps instead of " + std::to_string(measures.roomCrossings) + " and " + std::to_string(measures.corridorOverlaps);
+
+        Dungeon parallel;
+        runGenerator(worker.parallel, frontier, parallel);
+
+        difference = compareDungeons(expected, parallel);
+        if(!difference.empty())
+            return "parallel placement: " + difference;
+
+        return {};
+    }
+
+    // A chunk generated again, by a world that generated it or another chunk just before and by a
+    // fresh world, is the same. A rejected chunk has no rooms, only the corridors of its portals
+    std::string checkChunk(const ChunkCase& chunkCase, std::uint64_t* hash = nullptr)
+    {
+        const int size = chunkCase.chunkSize;
+        const Vec2i coord = chunkCase.coord;
+
+        ChunkedWorld world(chunkCase.settings, size);
+
+        WorldChunk expected;
+        world.generateChunk(coord, expected);
+
+        if(hash)
+        {
+            Hash chunkHash;
+            for(const auto& room : expected.rooms)
+            {
+                chunkHash.add(room.pos);
+                chunkHash.add(room.size);
+            }
+
+            for(const auto& corridor : expected.corridors)
+            {
+                chunkHash.add(corridor.start);
+                chunkHash.add(corridor.end);
+            }
+
+            for(int y = 0; y < size; y++)
+            {
+                for(int x = 0; x < size; x++)
+                    chunkHash.add(expected.map.getTile({x, y}) ? 1 : 0);
+            }
+
+            *hash = chunkHash.value;
+        }
+
+        WorldChunk chunk;
+        world.generateChunk(coord, chunk);
+
+        auto difference = compareChunks(expected, chunk);
+        if(!difference.empty())
+            return "same chunk again: " + difference;
+
+        world.generateChunk(coord + Vec2i(1, 0), chunk);
+        world.generateChunk(coord, chunk);
+
+        difference = compareChunks(expected, chunk);
+        if(!difference.empty())
+            return "after its neighbour: " + difference;
+
+        ChunkedWorld fresh(chunkCase.settings, size);
+        fresh.generateChunk(coord, chunk);
+
+        difference = compareChunks(expected, chunk);
+        if(!difference.empty())
+            return "fresh world: " + difference;
+
+        const int minRooms = chunkCase.settings.acceptance.minRooms;
+        if(!expected.rooms.empty() && static_cast<int>(expected.rooms.size()) < minRooms)
+            return "kept a chunk of " + std::to_string(expected.rooms.size()) + " rooms out of " + std::to_string(minRooms);
+
+        if(expected.rooms.empty() && !expected.edges.empty())
+            return "edges without rooms";
+
+        if(expected.map.getSize() != Vec2i(size, size))
+            return "the map is " + toString(expected.map.getSize());
+
+        for(const auto& corridor : expected.corridors)
+        {
+            if(corridor.start.x < 0 || corridor.start.y < 0 || corridor.end.x > size || corridor.end.y > size)
+                return "corridor " + toString(corridor.start) + " " + toString(corridor.end) + " leaves the chunk";
+        }
+
+        for(const auto& portal : expected.portals)
+        {
+            if(!expected.map.getTile(portal))
+                return "portal " + toString(portal) + " isn't carved";
+        }
+
+        // without rooms every tile is on the way to a portal
+        if(expected.rooms.empty())
+        {
+            for(int y = 0; y < size; y++)
+            {
+                for(int x = 0; x < size; x++)
+                {
+                    if(!expected.map.getTile({x, y}))
+                        continue;
+
+                    const bool inCorridor = std::any_of(expected.corridors.begin(), expected.corridors.end(), [&](const Dungeon::Corridor& corridor)
+                    {
+                        return x >= corridor.start.x && y >= corridor.start.y && x < corridor.end.x && y < corridor.end.y;
+                    });
+
+                    if(!inCorridor)
+                        return "tile " + toString(Vec2i(x, y)) + " of a rejected chunk is carved";
+                }
+            }
+        }
+
+        return {};
+    }
+
+    // A dungeon file read back is the dungeon written. The same file with a damaged header, like
+    // sizes whose product overflows, a truncated file or random bytes, is refused or only
+    // points inside the file
+    std::string checkFile(const Dungeon& parameters, Worker& worker, RandomStream& rnd, std::uint64_t* hash = nullptr)
+    {
+        Dungeon dungeon = parameters;
+        runGenerator(worker.cached, parameters, dungeon);
+        const auto& map = worker.cached.getMap();
+
+        std::ostringstream stream;
+        writeDungeon(stream, dungeon, map);
+        const std::string bytes = stream.str();
+
+        // words so the file is aligned like a mapping
+        std::vector<std::uint64_t> file((bytes.size() + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t));
+        std::memcpy(file.data(), bytes.data(), bytes.size());
+
+        if(hash)
+        {
+            Hash fileHash;
+            for(const char byte : bytes)
+                fileHash.add(static_cast<unsigned char>(byte));
+
+            *hash = fileHash.value;
+        }
+
+        DungeonView view;
+        if(!view.open(file.data(), bytes.size()))
+            return "the file written isn't valid";
+
+        Dungeon read;
+        TileMap<bool> readMap;
+        view.copyTo(read, readMap);
+
+        auto difference = compareDungeons(dungeon, read);
+        if(!difference.empty())
+            return "read back: " + difference;
+
+        if(readMap.getSize() != map.getSize())
+            return "the map read back is " + toString(readMap.getSize());
+
+        for(int y = 0; y < map.getSize().y; y++)
+        {
+            for(int x = 0; x < map.getSize().x; x++)
+            {
+                if(readMap.getTile({x, y}) != map.getTile({x, y}))
+                    return "tile " + toString(Vec2i(x, y)) + " read back differs";
+            }
+        }
+
+        // the first damage is always the one overflowing 64 bits, the others are drawn
+        const std::uint64_t hostile[] = {0, 1, 31, 0x7fffffff, 0x80000000, 0xffffffff, 1ull << 30, 1ull << 61, ~0ull};
+
+        for(int damage = 0; damage < 8; damage++)
+        {
+            auto damaged = file;
+            auto* header = reinterpret_cast<DungeonFileHeader*>(damaged.data());
+            std::size_t size = bytes.size();
+            std::string what;
+
+            auto pick = [&]{return hostile[rnd.uniform(0, std::size(hostile) - 1)];};
+
+            if(damage == 0)
+            {
+                header->height = 1 << 30;
+                header->tileStride = 1u << 31;
+                header->kindsOffset = 0;
+                what = "height 2^30 and stride 2^31";
+            }
+            else switch(rnd.uniform(0, 6))
+            {
+                case 0:
+                    header->width = pick();
+                    header->height = pick();
+                    what = "size " + std::to_string(header->width) + "x" + std::to_string(header->height);
+                    break;
+                case 1:
+                    header->tileStride = pick();
+                    header->height = pick();
+                    what = "stride " + std::to_string(header->tileStride) + " height " + std::to_string(header->height);
+                    break;
+                case 2:
+                    (rnd.uniform(0, 1) ? header->roomCount : rnd.uniform(0, 1) ? header->corridorCount : header->edgeCount) = pick();
+                    what = "a table count";
+                    break;
+                case 3:
+                {
+                    std::uint64_t* offsets[] = {&header->roomsOffset, &header->corridorsOffset, &header->edgesOffset, &header->tilesOffset, &header->kindsOffset, &header->fileSize};
+                    *offsets[rnd.uniform(0, std::size(offsets) - 1)] = rnd.uniform(0, 1) ? pick() : rnd.uniform(0, bytes.size() + 64);
+                    what = "an offset";
+                    break;
+                }
+                case 4:
+                    size = rnd.uniform(0, bytes.size() - 1);
+                    what = "truncated to " + std::to_string(size) + " bytes";
+                    break;
+                default:
+                    for(int x = rnd.uniform(1, 8); x > 0; x--)
+                        reinterpret_cast<unsigned char*>(header)[rnd.uniform(0, sizeof(DungeonFileHeader) - 1)] = rnd.uniform(0, 255);
+                    what = "random header bytes";
+                    break;
+            }
+
+            DungeonView damagedView;
+            if(!damagedView.open(damaged.data(), size))
+                continue;
+
+            if(damage == 0)
+                return "a file with " + what + " is opened";
+
+            // everything the view hands out is inside the file
+            const auto* begin = reinterpret_cast<const char*>(damaged.data());
+            auto inside = [&](const void* data, std::uint64_t count, std::size_t itemSize)
+            {
+                const auto* first = static_cast<const char*>(data);
+                return first >= begin && std::uint64_t(first - begin) <= size && count <= (size - (first - begin)) / itemSize;
+            };
+
+            const auto& damagedHeader = damagedView.getHeader();
+            if(
+                !inside(damagedView.getRooms(), damagedView.getRoomCount(), sizeof(Dungeon::Room)) ||
+                !inside(damagedView.getCorridors(), damagedView.getCorridorCount(), sizeof(Dungeon::Corridor)) ||
+                !inside(damagedView.getEdges(), damagedView.getEdgeCount(), sizeof(Edge)) ||
+                !inside(damagedView.row(0), std::uint64_t(damagedHeader.height) * damagedHeader.tileStride, sizeof(TileMap<bool>::Word)) ||
+                (damagedView.hasKinds() && !inside(damagedView.getKinds(), std::uint64_t(damagedHeader.width) * damagedHeader.height, 1)))
+                return "a file with " + what + " points outside of it";
+
+            Dungeon copy;
+            TileMap<bool> copyMap;
+            damagedView.copyTo(copy, copyMap);
+        }
+
+        return {};
+    }
+
+    // Every tile kernel the cpu runs against a byte loop, on runs at any alignment, shorter than
+    // a word or a register included, then the bitmap and byte tile maps using them against a
+    // grid of chars, on rects clipped to the map and with edges inside words
+    std::string checkKernels(RandomStream& rnd, std::uint64_t* hash = nullptr)
+    {
+        Hash results;
+
+        // the draws clamped to their bounds, the compiler then knows they can't wrap around
+        auto drawSize = [&](int max)
+        {
+            return static_cast<std::size_t>(std::clamp(rnd.uniform(0, max), 0, max));
+        };
+
+        for(int run = 0; run < 16; run++)
+        {
+            const std::size_t offset = drawSize(63);
+            const std::size_t size = rnd.uniform(0, 1) ? drawSize(40) : drawSize(600);
+            const int pick = rnd.uniform(0, 2);
+            const std::uint8_t value = pick == 0 ? 0 : pick == 1 ? 0xff : rnd.uniform(0, 255);
+
+            // the bytes around the run differ, a kernel reading past it finds them
+            std::vector<std::uint8_t> buffer(offset + size + 64, value ^ 1);
+            std::fill_n(buffer.begin() + offset, size, value);
+
+            if(size && rnd.uniform(0, 3))
+            {
+                for(int x = rnd.uniform(1, 3); x > 0; x--)
+                    buffer[offset + rnd.uniform(0, size - 1)] = rnd.uniform(0, 1) ? value ^ (1 << rnd.uniform(0, 7)) : rnd.uniform(0, 255);
+            }
+
+            const std::uint8_t* data = buffer.data() + offset;
+
+            std::size_t expected = 0;
+            while(expected < size && data[expected] == value)
+                expected++;
+
+            results.add(static_cast<int>(expected));
+
+            for(const auto& kernel : tileKernels::getKernels())
+            {
+                const std::size_t found = kernel.find(data, size, value);
+                if(found != expected)
+                    return std::string(kernel.name) + " finds " + std::to_string(found) + " instead of " + std::to_string(expected) + " in " + std::to_string(size) + " bytes at offset " + std::to_string(offset) + " of " + std::to_string(value);
+            }
+
+            if(tileKernels::anyNonZero(data, size) != std::any_of(data, data + size, [](std::uint8_t byte){return byte != 0;}))
+                return "anyNonZero differs on " + std::to_string(size) + " bytes at offset " + std::to_string(offset);
+        }
+
+        const Vec2i size = {rnd.uniform(0, 2) ? rnd.uniform(1, 300) : rnd.uniform(1, 70), rnd.uniform(1, 6)};
+        TileMap<bool> map;
+        map.setSize(size);
+
+        TileMap<Dungeon::Tile> tiles;
+        tiles.setSize(size);
+        std::fill(tiles.tiles.begin(), tiles.tiles.end(), Dungeon::EMPTY);
+
+        std::vector<char> grid(size.x * size.y, 0);
+        std::vector<Dungeon::Tile> tileGrid(size.x * size.y, Dungeon::EMPTY);
+
+        auto randomRect = [&](Vec2i& pos, Vec2i& rectSize)
+        {
+            pos = {rnd.uniform(-8, size.x + 8), rnd.uniform(-2, size.y + 2)};
+            rectSize = {rnd.uniform(-2, 0) ? rnd.uniform(0, 70) : rnd.uniform(0, size.x + 16), rnd.uniform(0, size.y + 2)};
+        };
+
+        // the naive loop over the tiles of the rect inside the map
+        auto forEachInRect = [&](const Vec2i& pos, const Vec2i& rectSize, auto function)
+        {
+            for(int y = std::max(pos.y, 0); y < std::min(pos.y + rectSize.y, size.y); y++)
+            {
+                for(int x = std::max(pos.x, 0); x < std::min(pos.x + rectSize.x, size.x); x++)
+                    function(y * size.x + x);
+            }
+        };
+
+        for(int fill = rnd.uniform(1, 12); fill > 0; fill--)
+        {
+            Vec2i pos, rectSize;
+            randomRect(pos, rectSize);
+
+            const bool tile = rnd.uniform(0, 2);
+            map.fillRect(pos, rectSize, tile);
+            forEachInRect(pos, rectSize, [&](int index){grid[index] = tile;});
+
+            const auto kind = static_cast<Dungeon::Tile>(rnd.uniform(0, Dungeon::DOOR));
+            tiles.fillRect(pos, rectSize, kind);
+            forEachInRect(pos, rectSize, [&](int index){tileGrid[index] = kind;});
+        }
+
+        for(int y = 0; y < size.y; y++)
+        {
+            for(int x = 0; x < size.x; x++)
+            {
+                if(map.getTile({x, y}) != bool(grid[y * size.x + x]))
+                    return "fillRect leaves tile " + toString(Vec2i(x, y)) + " wrong";
+            }
+        }
+
+        for(int query = 0; query < 24; query++)
+        {
+            Vec2i pos, rectSize;
+            randomRect(pos, rectSize);
+
+            int count = 0;
+            int kinds = 0;
+            forEachInRect(pos, rectSize, [&](int index)
+            {
+                count += grid[index];
+                kinds += tileGrid[index] != Dungeon::EMPTY;
+            });
+
+            results.add(count);
+
+            if(map.anyInRect(pos, rectSize) != (count > 0) || map.countInRect(pos, rectSize) != count)
+                return "the bitmap counts " + std::to_string(map.countInRect(pos, rectSize)) + " tiles instead of " + std::to_string(count) + " in " + toString(pos) + " size " + toString(rectSize);
+
+            if(tiles.anyInRect(pos, rectSize) != (kinds > 0))
+                return "the byte tiles have " + std::to_string(kinds) + " tiles in " + toString(pos) + " size " + toString(rectSize) + " and anyInRect doesn't agree";
+        }
+
+        for(int y = 0; y < size.y; y++)
+        {
+            const char* row = grid.data() + y * size.x;
+
+            for(int from = 0; from <= size.x; from++)
+            {
+                for(const bool tile : {false, true})
+                {
+                    int expected = from;
+                    while(expected < size.x && bool(row[expected]) != tile)
+                        expected++;
+
+                    if(map.findNext(y, from, tile) != expected)
+                        return "findNext(" + std::to_string(y) + ", " + std::to_string(from) + ", " + std::to_string(tile) + ") of a " + toString(size) + " map is " + std::to_string(map.findNext(y, from, tile)) + " instead of " + std::to_string(expected);
+                }
+            }
+
+            std::vector<std::pair<int, int>> spans;
+            map.forEachSpan(y, [&](int begin, int end){spans.emplace_back(begin, end);});
+
+            std::vector<std::pair<int, int>> expectedSpans;
+            for(int x = 0; x < size.x; x++)
+            {
+                if(row[x] && (x == 0 || !row[x - 1]))
+                    expectedSpans.emplace_back(x, x);
+                if(row[x])
+                    expectedSpans.back().second = x + 1;
+            }
+
+            if(spans != expectedSpans)
+                return "forEachSpan of row " + std::to_string(y) + " differs";
+
+            for(const auto& span : spans)
+                results.add({span.first, span.second});
+
+            const Dungeon::Tile* tileRow = tileGrid.data() + y * size.x;
+
+            std::vector<std::pair<int, int>> runs;
+            tiles.forEachRun(y, [&](int begin, int end, Dungeon::Tile tile)
+            {
+                runs.emplace_back(begin, end);
+                if(std::any_of(tileRow + begin, tileRow + end, [&](Dungeon::Tile other){return other != tile;}))
+                    runs.emplace_back(-1, -1);
+            });
+
+            std::vector<std::pair<int, int>> expectedRuns;
+            for(int x = 0; x < size.x; x++)
+            {
+                if(x == 0 || tileRow[x] != tileRow[x - 1])
+                    expectedRuns.emplace_back(x, x);
+                expectedRuns.back().second = x + 1;
+            }
+
+            if(runs != expectedRuns)
+                return "forEachRun of row " + std::to_string(y) + " differs";
+        }
+
+        if(hash)
+            *hash = results.value;
+
+        return {};
+    }
+
+    struct PresetCase
+    {
+        int preset;
+        int seed;
+    };
+
+    PresetCase makePresetCase(RandomStream& rnd)
+    {
+        const int preset = rnd.uniform(0, 2);
+        return {preset, rnd.uniform(0, std::numeric_limits<int>::max())};
+    }
+
+    template <typename Preset>
+    std::string checkPresetGenerator(PresetGenerator<Preset>& preset, int seed, std::uint64_t* hash)
+    {
+        const Dungeon& dungeon = preset.generate(seed);
+
+        Dungeon expected = Preset::make(seed);
+        generateDungeon(expected);
+
+        if(hash)
+            *hash = hashDungeon(expected);
+
+        const auto difference = compareDungeons(expected, dungeon);
+        if(!difference.empty())
+            return difference;
+
+        if(preset.getOverflowCount())
+            return std::to_string(preset.getOverflowCount()) + " allocations of the generator went past the memory of the preset";
+
+        return {};
+    }
+
+    // A preset generator against a plain generator given the parameters of the preset. The
+    // worker keeps the preset generators, none of their allocations may reach the heap over
+    // all the cases it runs
+    std::string checkPreset(const PresetCase& presetCase, Worker& worker, std::uint64_t* hash = nullptr)
+    {
+        if(presetCase.preset == 0)
+            return checkPresetGenerator(*worker.defaultPreset, presetCase.seed, hash);
+        if(presetCase.preset == 1)
+            return checkPresetGenerator(*worker.smallPreset, presetCase.seed, hash);
+
+        return checkPresetGenerator(*worker.widePreset, presetCase.seed, hash);
+    }
+
+    // Remove items, the biggest runs first, as long as the case keeps failing
+    template <typename T, typename Fails>
+    void shrinkList(std::vector<T>& items, Fails fails)
+    {
+        std::size_t chunk = items.size() / 2;
+        while(chunk > 0)
+        {
+            bool removed = false;
+            for(std::size_t start = 0; start + chunk <= items.size();)
+            {
+                auto candidate = items;
+                candidate.erase(candidate.begin() + start, candidate.begin() + start + chunk);
+
+                if(fails(candidate))
+                {
+                    items = std::move(candidate);
+                    removed = true;
+                }
+                else
+                    start += chunk;
+            }
+
+            if(!removed)
+                chunk /= 2;
+            else
+                chunk = std::min(chunk, items.size() / 2);
+        }
+    }
+
+    std::vector<Vec2i> shrinkPoints(std::vector<Vec2i> points)
+    {
+        Triangulator triangulator;
+        auto fails = [&](const std::vector<Vec2i>& candidate)
+        {
+            return !checkTriangulation(candidate, triangulator).empty();
+        };
+
+        shrinkList(points, fails);
+
+        // the same points next to the origin
+        if(!points.empty())
+        {
+            Vec2i min = points.front();
+            for(const auto& point : points)
+                min = {std::min(min.x, point.x), std::min(min.y, point.y)};
+
+            auto moved = points;
+            for(auto& point : moved)
+                point = point - min;
+
+            if(fails(moved))
+                points = moved;
+        }
+
+        return points;
+    }
+
+    Graph shrinkGraph(Graph graph)
+    {
+        auto fails = [&](const Graph& candidate)
+        {
+            return !checkSpanningTree(candidate).empty();
+        };
+
+        shrinkList(graph.edges, [&](const std::vector<std::pair<int, int>>& edges)
+        {
+            return fails({graph.points, edges});
+        });
+
+        // drop the points no edge links
+        std::vector<int> remap(graph.points.size(), -1);
+        Graph linked;
+        for(auto edge : graph.edges)
+        {
+            for(int* point : {&edge.first, &edge.second})
+            {
+                if(remap[*point] == -1)
+                {
+                    remap[*point] = linked.points.size();
+                    linked.points.push_back(graph.points[*point]);
+                }
+
+                *point = remap[*point];
+            }
+
+            linked.edges.push_back(edge);
+        }
+
+        return fails(linked) ? linked : graph;
+    }
+
+    // Lower the parameters one at a time while the same path keeps differing
+    Dungeon shrinkDungeon(Dungeon dungeon, const std::string& failure)
+    {
+        Worker worker;
+
+        const auto path = failure.substr(0, failure.find(':'));
+        auto fails = [&](const Dungeon& candidate)
+        {
+            const auto result = checkDungeon(candidate, worker);
+            return result.compare(0, path.size(), path) == 0;
+        };
+
+        // set value to lowered if it's lower, false if it isn't
+        auto lower = [](int& value, int lowered)
+        {
+            if(lowered >= value)
+                return false;
+
+            value = lowered;
+            return true;
+        };
+
+        // the map stays twice as big as the rooms and the rooms 3 times as big as the door distance
+        auto minSize = [](const Dungeon& d)
+        {
+            return d.roomSizeMax * 2 + 1;
+        };
+
+        const std::vector<std::function<bool(Dungeon&)>> reductions = {
+            [&](Dungeon& d){return lower(d.roomPoolSize, d.roomPoolSize / 2);},
+            [&](Dungeon& d){return lower(d.roomPoolSize, std::max(d.roomPoolSize - 1, 0));},
+            [&](Dungeon& d){return lower(d.additionalEdge, d.additionalEdge / 2);},
+            [&](Dungeon& d){return lower(d.additionalEdge, std::max(d.additionalEdge - 1, 0));},
+            [&](Dungeon& d){return std::exchange(d.spanningTree, Dungeon::KRUSKAL) != Dungeon::KRUSKAL;},
+            [&](Dungeon& d){return lower(d.size.x, std::max(d.size.x / 2, minSize(d)));},
+            [&](Dungeon& d){return lower(d.size.y, std::max(d.size.y / 2, minSize(d)));},
+            [&](Dungeon& d){return lower(d.size.x, std::max(d.size.x - 1, minSize(d)));},
+            [&](Dungeon& d){return lower(d.size.y, std::max(d.size.y - 1, minSize(d)));},
+            [&](Dungeon& d){return lower(d.roomSizeMax, std::max(d.roomSizeMax - 1, d.roomSizeMin));},
+            [&](Dungeon& d){return lower(d.roomSizeMin, std::max(d.roomSizeMin - 1, std::max(1, d.minDoorDistToCorner * 3)));},
+            [&](Dungeon& d){return lower(d.minimalRoomDistance, std::max(d.minimalRoomDistance - 1, 0));},
+            [&](Dungeon& d){return lower(d.minimalDirectionalRoomDistance, std::max(d.minimalDirectionalRoomDistance - 1, 0));},
+            [&](Dungeon& d){return lower(d.minDoorDistToCorner, std::max(d.minDoorDistToCorner - 1, 0));},
+        };
+
+        bool shrunk = true;
+        while(shrunk)
+        {
+            shrunk = false;
+            for(const auto& reduce : reductions)
+            {
+                Dungeon candidate = dungeon;
+                if(!reduce(candidate))
+                    continue;
+
+                if(fails(candidate))
+                {
+                    dungeon = candidate;
+                    shrunk = true;
+                }
+            }
+        }
+
+        return dungeon;
+    }
+
+    // the parameters as the options of batch.cpp
+    std::string toBatchCommand(const Dungeon& dungeon)
+    {
+        std::string command = "./batch --seeds " + std::to_string(dungeon.seed) + ":1";
+        command += " --size " + std::to_string(dungeon.size.x) + "x" + std::to_string(dungeon.size.y);
+        command += " --room-size " + std::to_string(dungeon.roomSizeMin) + ":" + std::to_string(dungeon.roomSizeMax);
+        command += " --pool " + std::to_string(dungeon.roomPoolSize);
+        command += " --distance " + std::to_string(dungeon.minimalRoomDistance);
+        command += " --directional-distance " + std::to_string(dungeon.minimalDirectionalRoomDistance);
+        command += " --additional-edges " + std::to_string(dungeon.additionalEdge);
+        command += " --door-corner " + std::to_string(dungeon.minDoorDistToCorner);
+
+        if(dungeon.spanningTree == Dungeon::PRIM)
+            command += " --prim";
+
+        return command;
+    }
+
+    std::string toString(const std::vector<Vec2i>& points)
+    {
+        std::string text = "{";
+        for(const auto& point : points)
+            text += (&point == &points.front() ? "{" : ", {") + toString(point) + "}";
+
+        return text + "}";
+    }
+
+    RandomStream caseRandom(std::uint64_t seed, Check check, int index)
+    {
+        return RandomStream(seed, {std::uint32_t(check), std::uint32_t(index)});
+    }
+
+    // The hashes of the results of every case, by check. A line with the seed, then for every
+    // check recorded a line with its name and case count followed by a hash per line
+    using Record = std::array<std::vector<std::uint64_t>, CHECK_COUNT>;
+
+    bool readRecord(const char* path, std::uint64_t& seed, Record& record, std::array<bool, CHECK_COUNT>& checks)
+    {
+        std::ifstream file(path);
+        std::string magic;
+        if(!(file >> magic >> seed) || magic != "dungeonFuzz")
+            return false;
+
+        checks = {};
+
+        std::string name;
+        std::size_t count;
+        while(file >> std::dec >> name >> count)
+        {
+            const auto check = std::find_if(std::begin(checkNames), std::end(checkNames), [&](const char* checkName){return name == checkName;});
+            if(check == std::end(checkNames))
+                return false;
+
+            auto& hashes = record[check - std::begin(checkNames)];
+            checks[check - std::begin(checkNames)] = true;
+
+            hashes.resize(count);
+            for(auto& hash : hashes)
+            {
+                if(!(file >> std::hex >> hash))
+                    return false;
+            }
+        }
+
+        return file.eof();
+    }
+
+    bool writeRecord(const char* path, std::uint64_t seed, const Record& record, const std::array<bool, CHECK_COUNT>& checks)
+    {
+        std::ofstream file(path);
+        file << "dungeonFuzz " << seed << '\n';
+
+        for(int check = 0; check < CHECK_COUNT; check++)
+        {
+            if(!checks[check])
+                continue;
+
+            file << std::dec << checkNames[check] << ' ' << record[check].size() << '\n' << std::hex;
+            for(const auto hash : record[check])
+                file << hash << '\n';
+        }
+
+        return bool(file);
+    }
+
+    void printGraph(const Graph& graph)
+    {
+        std::cout << "  points " << toString(graph.points) << "\n  edges {";
+        for(const auto& edge : graph.edges)
+            std::cout << (&edge == &graph.edges.front() ? "{" : ", {") << edge.first << ", " << edge.second << "}";
+        std::cout << "}\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if(!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    Record recorded;
+    if(options.verify && !readRecord(options.verify, options.seed, recorded, options.checks))
+    {
+        std::cerr << "can't read " << options.verify << '\n';
+        return 1;
+    }
+
+    ThreadPool pool(options.threads);
+    std::vector<std::unique_ptr<Worker>> workers(pool.size() + 1);
+
+    Record record;
+    bool diverged = false;
+
+    for(int check = 0; check < CHECK_COUNT; check++)
+    {
+        if(!options.checks[check])
+            continue;
+
+        const int caseCount = options.verify ? recorded[check].size() : options.caseCount;
+        auto& hashes = record[check];
+        if(options.record || options.verify)
+            hashes.resize(caseCount);
+
+        const auto start = std::chrono::steady_clock::now();
+
+        // the first failing case, the cases after it are skipped
+        std::atomic<int> firstFailure(caseCount);
+
+        auto fail = [&](int index)
+        {
+            int first = firstFailure;
+            while(index < first && !firstFailure.compare_exchange_weak(first, index))
+            {
+            }
+        };
+
+        pool.parallelFor(0, caseCount, [&](int index)
+        {
+            if(index > firstFailure)
+                return;
+
+            auto& worker = workers[pool.workerIndex() + 1];
+            if(!worker)
+                worker.reset(new Worker);
+
+            auto rnd = caseRandom(options.seed, Check(check), index);
+            auto* hash = hashes.empty() ? nullptr : &hashes[index];
+
+            std::string failure;
+            if(check == TRIANGULATION)
+                failure = checkTriangulation(makePoints(rnd, options.maxPoints), worker->triangulator, hash);
+            else if(check == SPANNING_TREE)
+                failure = checkSpanningTree(makeGraph(rnd, options.maxPoints), hash);
+            else if(check == DUNGEON)
+                failure = checkDungeon(makeDungeon(rnd), *worker, hash);
+            else if(check == CHUNK)
+                failure = checkChunk(makeChunkCase(rnd), hash);
+            else if(check == DUNGEON_FILE)
+            {
+                const auto dungeon = makeDungeon(rnd);
+                failure = checkFile(dungeon, *worker, rnd, hash);
+            }
+            else if(check == KERNELS)
+                failure = checkKernels(rnd, hash);
+            else
+                failure = checkPreset(makePresetCase(rnd), *worker, hash);
+
+            if(!failure.empty() || (options.verify && *hash != recorded[check][index]))
+                fail(index);
+        }, 16);
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const int index = firstFailure;
+        if(index == caseCount)
+        {
+            std::cout << checkNames[check] << ": " << caseCount << " cases, no divergence (" << seconds << " s)\n";
+            continue;
+        }
+
+        diverged = true;
+
+        // the failing case again, on this thread, then shrunk. When it only differs from the
+        // record there's nothing to shrink against, the recorded code is gone
+        auto rnd = caseRandom(options.seed, Check(check), index);
+        std::cout << checkNames[check] << ": case " << index << " of seed " << options.seed << " diverges\n";
+
+        if(check == TRIANGULATION)
+        {
+            const auto points = makePoints(rnd, options.maxPoints);
+
+            Triangulator triangulator;
+            const auto failure = checkTriangulation(points, triangulator);
+            if(failure.empty())
+            {
+                std::cout << "  the edges aren't the recorded ones\n";
+                std::cout << "  " << toString(points) << '\n';
+                continue;
+            }
+
+            std::cout << "  " << failure << " with " << points.size() << " points\n";
+
+            const auto shrunk = shrinkPoints(points);
+            std::cout << "  shrunk to " << shrunk.size() << " points, " << checkTriangulation(shrunk, triangulator) << ":\n";
+            std::cout << "  " << toString(shrunk) << '\n';
+        }
+        else if(check == SPANNING_TREE)
+        {
+            const auto graph = makeGraph(rnd, options.maxPoints);
+
+            const auto failure = checkSpanningTree(graph);
+            if(failure.empty())
+            {
+                std::cout << "  the trees aren't the recorded ones\n";
+                printGraph(graph);
+                continue;
+            }
+
+            std::cout << "  " << failure << " with " << graph.points.size() << " points and " << graph.edges.size() << " edges\n";
+
+            const auto shrunk = shrinkGraph(graph);
+            std::cout << "  shrunk to " << shrunk.points.size() << " points and " << shrunk.edges.size() << " edges, " << checkSpanningTree(shrunk) << ":\n";
+            printGraph(shrunk);
+        }
+        else if(check == DUNGEON)
+        {
+            const auto dungeon = makeDungeon(rnd);
+
+            Worker worker;
+            const auto failure = checkDungeon(dungeon, worker);
+            if(failure.empty())
+            {
+                std::cout << "  the dungeon isn't the recorded one\n";
+                std::cout << "  " << toBatchCommand(dungeon) << '\n';
+                continue;
+            }
+
+            std::cout << "  " << failure << '\n';
+            std::cout << "  " << toBatchCommand(dungeon) << '\n';
+
+            const auto shrunk = shrinkDungeon(dungeon, failure);
+            std::cout << "  shrunk to, " << checkDungeon(shrunk, worker) << ":\n";
+            std::cout << "  " << toBatchCommand(shrunk) << '\n';
+        }
+        else if(check == CHUNK)
+        {
+            const auto chunk = makeChunkCase(rnd);
+
+            const auto failure = checkChunk(chunk);
+            std::cout << "  " << (failure.empty() ? "the chunk isn't the recorded one" : failure) << '\n';
+            std::cout << "  chunk " << toString(chunk.coord) << " of size " << chunk.chunkSize << ", at least " << chunk.settings.acceptance.minRooms << " rooms, settings of\n";
+            std::cout << "  " << toBatchCommand(chunk.settings) << '\n';
+        }
+        else if(check == DUNGEON_FILE)
+        {
+            const auto dungeon = makeDungeon(rnd);
+
+            Worker worker;
+            const auto failure = checkFile(dungeon, worker, rnd);
+            std::cout << "  " << (failure.empty() ? "the file isn't the recorded one" : failure) << '\n';
+            std::cout << "  written from " << toBatchCommand(dungeon) << '\n';
+        }
+        else if(check == KERNELS)
+        {
+            const auto failure = checkKernels(rnd);
+            std::cout << "  " << (failure.empty() ? "the results aren't the recorded ones" : failure) << " (" << tileKernels::getName() << " picked)\n";
+        }
+        else
+        {
+            const auto presetCase = makePresetCase(rnd);
+
+            // a fresh generator, an overflow after many seeds may not show on the first one
+            Worker worker;
+            const auto failure = checkPreset(presetCase, worker);
+            std::cout << "  " << (failure.empty() ? "the dungeon isn't the recorded one, or only overflows after other seeds" : failure) << '\n';
+            std::cout << "  " << presetNames[presetCase.preset] << " with seed " << presetCase.seed << '\n';
+        }
+    }
+
+    // only a run where everything agreed is worth recording
+    if(options.record && !diverged && !writeRecord(options.record, options.seed, record, options.checks))
+    {
+        std::cerr << "can't write " << options.record << '\n';
+        return 1;
+    }
+
+    return diverged ? 2 : 0;
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <memory_resource>
+
+// Forward the allocations to another resource and count them
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) : upstream(upstream)
+    {
+    }
+
+    std::size_t getAllocationCount() const
+    {
+        return allocations;
+    }
+
+    std::size_t getAllocatedBytes() const
+    {
+        return bytes;
+    }
+
+private:
+    void* do_allocate(std::size_t size, std::size_t alignment) override
+    {
+        allocations++;
+        bytes += size;
+        return upstream->allocate(size, alignment);
+    }
+
+    void do_deallocate(void* pointer, std::size_t size, std::size_t alignment) override
+    {
+        upstream->deallocate(pointer, size, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* upstream;
+
+    std::size_t allocations = 0;
+    std::size_t bytes = 0;
+};
+
+// Monotonic arena, deallocating does nothing and reset() makes all of it available again.
+// The memory is kept between resets, if a run needed more than one block they are merged
+// in a single one on the next reset so a run as big as the previous ones doesn't allocate
+class ScratchArena : public std::pmr::memory_resource
+{
+public:
+    explicit ScratchArena(std::pmr::memory_resource* upstream, std::size_t blockSize = 64 * 1024) : upstream(upstream), blockSize(blockSize)
+    {
+    }
+
+    ~ScratchArena()
+    {
+        release();
+    }
+
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    void reset()
+    {
+        if(blockCount > 1)
+        {
+            const std::size_t total = capacity();
+            release();
+            addBlock(total);
+        }
+
+        offset = 0;
+    }
+
+    std::size_t capacity() const
+    {
+        std::size_t total = 0;
+        for(auto block = last; block; block = block->previous)
+            total += block->size;
+
+        return total;
+    }
+
+private:
+    struct Block
+    {
+        Block* previous;
+        std::size_t size;
+    };
+
+    static constexpr std::size_t headerSize = (sizeof(Block) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+    void* do_allocate(std::size_t size, std::size_t alignment) override
+    {
+        if(last)
+        {
+            const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(last) + headerSize;
+            const std::uintptr_t start = (base + offset + alignment - 1) / alignment * alignment;
+
+            if(start + size <= base + last->size)
+            {
+                offset = start + size - base;
+                return reinterpret_cast<void*>(start);
+            }
+        }
+
+        addBlock(std::max(size + alignment, blockSize));
+        blockSize *= 2;
+
+        return do_allocate(size, alignment);
+    }
+
+    void do_deallocate(void*, std::size_t, std::size_t) override
+    {
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    void addBlock(std::size_t size)
+    {
+        void* memory = upstream->allocate(headerSize + size, alignof(std::max_align_t));
+        last = new (memory) Block{last, size};
+        blockCount++;
+        offset = 0;
+    }
+
+    void release()
+    {
+        while(last)
+        {
+            Block* previous = last->previous;
+            upstream->deallocate(last, headerSize + last->size, alignof(std::max_align_t));
+            last = previous;
+        }
+
+        blockCount = 0;
+    }
+
+    std::pmr::memory_resource* upstream;
+    std::size_t blockSize;
+
+    Block* last = nullptr;
+    int blockCount = 0;
+    std::size_t offset = 0;
+};
+
+// Memory used by a generator.
+// What the stages keep from one run to the next comes from persistent(), what
+// they only need while running comes from scratch() which is reset every run.
+// Once a few dungeons were generated the capacities are big enough and
+// generating more doesn't allocate, getAllocationCount() stops increasing.
+class GeneratorContext
+{
+public:
+    GeneratorContext() = default;
+
+    // all the memory comes from upstream instead of the heap
+    explicit GeneratorContext(std::pmr::memory_resource* upstream) : heap(upstream)
+    {
+    }
+
+    GeneratorContext(const GeneratorContext&) = delete;
+    GeneratorContext& operator=(const GeneratorContext&) = delete;
+
+    std::pmr::memory_resource* persistent()
+    {
+        return &heap;
+    }
+
+    std::pmr::memory_resource* scratch()
+    {
+        return &arena;
+    }
+
+    // call at the start of a run, everything allocated from scratch() must be gone
+    void reset()
+    {
+        arena.reset();
+    }
+
+    // allocations made through the context since it was created
+    std::size_t getAllocationCount() const
+    {
+        return heap.getAllocationCount();
+    }
+
+private:
+    CountingResource heap;
+    ScratchArena arena{&heap};
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+// Instrumentation of the generator, define DUNGEON_STATS to 1 before including the
+// generator to record it. When it's 0 (the default) DUNGEON_STAT removes the code
+// recording it, the stats stay at zero and cost nothing.
+// Every file of a program must see the same value.
+#ifndef DUNGEON_STATS
+#define DUNGEON_STATS 0
+#endif
+
+#if DUNGEON_STATS
+#define DUNGEON_STAT(statement) statement
+#else
+#define DUNGEON_STAT(statement)
+#endif
+
+// Write the elapsed milliseconds in target when destroyed
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(double& target) : target(target), start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~ScopedTimer()
+    {
+        target = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    double& target;
+    std::chrono::steady_clock::time_point start;
+};
+
+// What the last run of a generator did
+struct GeneratorStats
+{
+    enum Stage {SIZES, PLACEMENT, TRIANGULATION, SPANNING_TREE, EDGES, CORRIDORS, NAVIGATION, STAGE_COUNT};
+
+    static const char* getStageName(int stage)
+    {
+        static const char* names[STAGE_COUNT] = {"sizes", "placement", "triangulation", "spanningTree", "edges", "corridors", "navigation"};
+        return names[stage];
+    }
+
+    // stages skipped because their result was cached are left at false and 0
+    std::array<bool, STAGE_COUNT> stageRan = {};
+    std::array<double, STAGE_COUNT> stageTime = {}; // milliseconds
+    double totalTime = 0;
+
+    std::uint64_t candidatePositions = 0; // positions evaluated while placing rooms
+    std::uint64_t rectQueries = 0;        // canPlaceRoom calls
+
+    std::uint64_t trianglesCreated = 0;
+    std::uint64_t trianglesDestroyed = 0;
+
+    std::uint64_t allocations = 0;        // heap allocations through the generator context
+
+    ScopedTimer time(Stage stage)
+    {
+        stageRan[stage] = true;
+        return ScopedTimer(stageTime[stage]);
+    }
+
+    std::string toJson() const
+    {
+        std::string json = "{\"stages\":{";
+        for(int stage = 0; stage < STAGE_COUNT; stage++)
+        {
+            json += stage ? ",\"" : "\"";
+            json += getStageName(stage);
+            json += "\":{\"ran\":";
+            json += stageRan[stage] ? "true" : "false";
+            json += ",\"ms\":" + std::to_string(stageTime[stage]) + "}";
+        }
+
+        json += "},\"totalMs\":" + std::to_string(totalTime);
+        json += ",\"candidatePositions\":" + std::to_string(candidatePositions);
+        json += ",\"rectQueries\":" + std::to_string(rectQueries);
+        json += ",\"trianglesCreated\":" + std::to_string(trianglesCreated);
+        json += ",\"trianglesDestroyed\":" + std::to_string(trianglesDestroyed);
+        json += ",\"allocations\":" + std::to_string(allocations);
+        json += "}";
+
+        return json;
+    }
+};
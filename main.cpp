@@ -1,8 +1,13 @@
+#define DUNGEON_STATS 1
+
 #include <SFML/System.hpp>
 #include <SFML/Graphics.hpp>
 
+#include "sfmlAdapter.hpp"
 #include "tilemap.hpp"
 #include "dungeonGenerator.hpp"
+#include "dungeonRenderer.hpp"
+#include "backgroundGenerator.hpp"
 
 #include <imgui.h>
 #include <imgui-SFML.h>
@@ -11,10 +16,21 @@ int main()
 {
     sf::RenderWindow window(sf::VideoMode(750, 750), "map");
 
+    window.setFramerateLimit(60);
+
     ImGui::SFML::Init(window);
 
+    // edited by the interface, dungeon is the last one generated
+    Dungeon parameters;
     Dungeon dungeon;
 
+    BackgroundGenerator generator;
+    GeneratorStats stats;
+    bool firstFrame = true;
+
+    DungeonRenderer renderer;
+    ViewController viewController(window.getDefaultView());
+
     sf::Clock deltaClock;
     while(window.isOpen())
     {
@@ -22,6 +38,7 @@ int main()
         while(window.pollEvent(event))
         {
             ImGui::SFML::ProcessEvent(event);
+            viewController.handleEvent(event, window, ImGui::GetIO().WantCaptureMouse);
 
             if (event.type == sf::Event::Closed)
             {
@@ -31,70 +48,103 @@ int main()
 
         window.clear();
 
-        dungeon.rooms.clear();
-        dungeon.corridors.clear();
-        dungeon.edges.clear();
-
         ImGui::SFML::Update(deltaClock.restart());
 
         ImGui::Begin("Data");
 
-        ImGui::SliderInt("Seed", &dungeon.seed, -1, 99999);
+        bool changed = false;
 
-        ImGui::SliderInt("Minimum Room Size", &dungeon.roomSizeMin, 2, dungeon.roomSizeMax);
-        ImGui::SliderInt("Maximum Room Size", &dungeon.roomSizeMax, dungeon.roomSizeMin, std::min(dungeon.size.x, dungeon.size.y));
+        changed |= ImGui::SliderInt("Seed", &parameters.seed, -1, 99999);
 
-        ImGui::SliderInt("Room Pool Size", &dungeon.roomPoolSize, 1, 100);
+        changed |= ImGui::SliderInt("Minimum Room Size", &parameters.roomSizeMin, 2, parameters.roomSizeMax);
+        changed |= ImGui::SliderInt("Maximum Room Size", &parameters.roomSizeMax, parameters.roomSizeMin, std::min(parameters.size.x, parameters.size.y));
 
-        ImGui::SliderInt("Distance", &dungeon.minimalRoomDistance, 1, 100);
-        ImGui::SliderInt("Directional Distance", &dungeon.minimalDirectionalRoomDistance, 1, 100);
+        changed |= ImGui::SliderInt("Map Width", &parameters.size.x, 10, 1000);
+        changed |= ImGui::SliderInt("Map Height", &parameters.size.y, 10, 1000);
 
-        ImGui::SliderInt("Additional Corridors", &dungeon.additionalEdge, 0, 100);
+        changed |= ImGui::SliderInt("Room Pool Size", &parameters.roomPoolSize, 1, 10000);
 
-        ImGui::SliderInt("Distance from door to corner", &dungeon.minDoorDistToCorner, 0, dungeon.roomSizeMin - 2);
+        changed |= ImGui::SliderInt("Distance", &parameters.minimalRoomDistance, 1, 100);
+        changed |= ImGui::SliderInt("Directional Distance", &parameters.minimalDirectionalRoomDistance, 1, 100);
 
-        ImGui::End(); // end windowindowindow
+        changed |= ImGui::SliderInt("Additional Corridors", &parameters.additionalEdge, 0, 100);
 
-        generateDungeon(dungeon);
+        changed |= ImGui::SliderInt("Distance from door to corner", &parameters.minDoorDistToCorner, 0, parameters.roomSizeMin - 2);
 
-        sf::RectangleShape rect({10, 10});
-        rect.setFillColor(sf::Color::White);
-        for(const auto& room: dungeon.rooms)
+        const char* placementModes[] = {"Frontier", "Exhaustive"};
+        int placement = parameters.placement;
+        if(ImGui::Combo("Placement", &placement, placementModes, 2))
         {
-            rect.setPosition((sf::Vector2f)room.pos * 10.f);
-            rect.setSize((sf::Vector2f)room.size * 10.f);
-            window.draw(rect);
+            parameters.placement = static_cast<Dungeon::PlacementMode>(placement);
+            changed = true;
         }
 
-        sf::CircleShape circle;
-        circle.setRadius(3);
-        circle.setOrigin(circle.getRadius(), circle.getRadius());
-        circle.setFillColor(sf::Color::Blue);
-        for(const auto& room : dungeon.rooms)
+        // the worker cancels the stale generation and starts on the new parameters,
+        // the dungeon shown stays until the new one is complete
+        if(changed || firstFrame || (parameters.seed == -1 && !generator.isBusy()))
+            generator.request(parameters);
+
+        firstFrame = false;
+
+        if(generator.isBusy())
         {
-            circle.setPosition((sf::Vector2f)(room.pos + room.size/2) * 10.f);
-            circle.move(0.5f, 0.5f);
-            window.draw(circle);
+            const int stage = generator.getStage();
+            const float progress = (stage + generator.getStageProgress()) / GeneratorStats::STAGE_COUNT;
+
+            ImGui::ProgressBar(progress, ImVec2(-1, 0), GeneratorStats::getStageName(stage));
         }
 
-        for(const auto& edge : dungeon.edges)
+        ImGui::End(); // end windowindowindow
+
+        if(generator.poll(dungeon, &stats))
+            renderer.build(dungeon);
+
+        ImGui::Begin("Stats");
+
+        for(int stage = 0; stage < GeneratorStats::STAGE_COUNT; stage++)
         {
-            sf::VertexArray va;
-            va.setPrimitiveType(sf::Lines);
-            va.append({(sf::Vector2f)edge.p1*10.f, sf::Color::Yellow});
-            va.append({(sf::Vector2f)edge.p2*10.f, sf::Color::Yellow});
-            window.draw(va);
+            if(stats.stageRan[stage])
+                ImGui::Text("%-14s %8.3f ms", GeneratorStats::getStageName(stage), stats.stageTime[stage]);
+            else
+                ImGui::Text("%-14s   cached", GeneratorStats::getStageName(stage));
         }
 
-        rect.setFillColor(sf::Color::Green);
-        for(const auto& corridor : dungeon.corridors)
-        {
-            rect.setPosition((sf::Vector2f)corridor.start*10.f);
-            rect.setSize((sf::Vector2f)corridor.end*10.f - (sf::Vector2f)corridor.start*10.f);
+        ImGui::Text("%-14s %8.3f ms", "total", stats.totalTime);
+
+        ImGui::Separator();
+
+        ImGui::Text("Candidate positions: %llu", static_cast<unsigned long long>(stats.candidatePositions));
+        ImGui::Text("Rect queries: %llu", static_cast<unsigned long long>(stats.rectQueries));
+        ImGui::Text("Triangles created: %llu", static_cast<unsigned long long>(stats.trianglesCreated));
+        ImGui::Text("Triangles destroyed: %llu", static_cast<unsigned long long>(stats.trianglesDestroyed));
+        ImGui::Text("Allocations: %llu", static_cast<unsigned long long>(stats.allocations));
+
+        ImGui::Separator();
+
+        ImGui::Text("Vertices: %u", static_cast<unsigned>(renderer.getVertexCount()));
+
+        ImGui::End();
 
-            window.draw(rect);
+        ImGui::Begin("View");
+
+        for(int layer = 0; layer < DungeonRenderer::LAYER_COUNT; layer++)
+        {
+            bool visible = renderer.isVisible(static_cast<DungeonRenderer::Layer>(layer));
+            if(ImGui::Checkbox(DungeonRenderer::getLayerName(layer), &visible))
+                renderer.setVisible(static_cast<DungeonRenderer::Layer>(layer), visible);
         }
 
+        if(ImGui::Button("Fit"))
+            viewController.fit(window, renderer.getSize());
+
+        ImGui::Text("Wheel to zoom, right drag to pan");
+
+        ImGui::End();
+
+        window.setView(viewController.getView());
+        window.draw(renderer);
+        window.setView(window.getDefaultView());
+
         ImGui::Render();
         window.display();
     }
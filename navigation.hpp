@@ -0,0 +1,321 @@
+#pragma once
+
+#include <deque>
+#include <queue>
+#include <limits>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <memory_resource>
+
+#include "vector2.hpp"
+#include "tilemap.hpp"
+
+// Direction to the target from every tile of a map, 4 bits per tile
+struct FlowField
+{
+    enum Step : std::uint8_t {NONE, UP, DOWN, LEFT, RIGHT, ARRIVED};
+
+    Vec2i target;
+    Vec2i size;
+
+    // two tiles per byte, the even one in the low bits
+    std::vector<std::uint8_t> steps;
+
+    Step getStep(const Vec2i& pos) const
+    {
+        if(pos.x < 0 || pos.y < 0 || pos.x >= size.x || pos.y >= size.y)
+            return NONE;
+
+        const int index = pos.y * size.x + pos.x;
+        return static_cast<Step>(steps[index / 2] >> (index % 2 * 4) & 0xf);
+    }
+
+    void setStep(int index, Step step)
+    {
+        auto& byte = steps[index / 2];
+        byte = static_cast<std::uint8_t>((byte & (0xf0 >> (index % 2 * 4))) | step << (index % 2 * 4));
+    }
+
+    static Vec2i toOffset(Step step)
+    {
+        static const Vec2i offsets[] = {{0, 0}, {0, -1}, {0, 1}, {-1, 0}, {1, 0}, {0, 0}};
+        return offsets[step];
+    }
+};
+
+// Paths over a generated dungeon, for agents walking it.
+// Between rooms: the graph of the rooms linked by the dungeon edges, with the next room on the
+// shortest path for every pair precomputed, so a room path is a lookup per room. The length of
+// an edge is the manhattan distance between the centers of its rooms, like the corridors run.
+// Between tiles: a flow field per target tile, computed the first time a target is asked for
+// with a breadth first search over the walkable tiles and kept for the next queries. Only
+// the last maxFlowFields ones are kept. Asking for flow fields isn't thread safe.
+// The room table takes rooms * rooms * 2 bytes, 20 KB for 100 rooms, and is built for every
+// dungeon. build() refuses dungeons of more than maxRooms rooms, keeping it under 2 MB
+class DungeonNavigation
+{
+public:
+    static constexpr std::uint16_t unreachable = std::numeric_limits<std::uint16_t>::max();
+    static constexpr int maxRooms = 1024;
+    static_assert(maxRooms < unreachable, "room indices are below the unreachable marker");
+
+    // bytes of the next room table of a dungeon of rooms rooms
+    static constexpr std::size_t getTableBytes(int rooms)
+    {
+        return std::size_t(rooms) * rooms * sizeof(std::uint16_t);
+    }
+
+    DungeonNavigation() = default;
+
+    explicit DungeonNavigation(std::pmr::memory_resource* resource) : nextRooms(resource), walkable(resource)
+    {
+    }
+
+    // the cache isn't copied, it fills up again on the copy
+    DungeonNavigation(const DungeonNavigation& other) : DungeonNavigation()
+    {
+        *this = other;
+    }
+
+    DungeonNavigation& operator=(const DungeonNavigation& other)
+    {
+        roomCount = other.roomCount;
+        nextRooms.assign(other.nextRooms.begin(), other.nextRooms.end());
+        walkable = other.walkable;
+        maxFlowFields = other.maxFlowFields;
+        flowFields.clear();
+        return *this;
+    }
+
+    DungeonNavigation(DungeonNavigation&&) = default;
+    DungeonNavigation& operator=(DungeonNavigation&&) = default;
+
+    // Rooms have a pos and a size, edges are pairs of room indices and walkable the tiles agents walk on.
+    // What's only needed while building comes from scratch. Return false, leaving the navigation
+    // empty, if there are more than maxRooms rooms
+    template <typename Rooms, typename Edges>
+    bool build(const Rooms& rooms, const Edges& edges, const TileMap<bool>& walkable, std::pmr::memory_resource* scratch = std::pmr::get_default_resource())
+    {
+        if(rooms.size() > std::size_t(maxRooms))
+        {
+            clear();
+            return false;
+        }
+
+        this->walkable = walkable;
+        flowFields.clear();
+
+        roomCount = static_cast<int>(rooms.size());
+
+        std::pmr::vector<Vec2i> centers(scratch);
+        for(const auto& room : rooms)
+            centers.push_back(room.pos + room.size/2);
+
+        // the links of room r are links[linkStart[r], linkStart[r + 1]), as (room, length)
+        std::pmr::vector<int> linkStart(roomCount + 1, 0, scratch);
+        for(const auto& edge : edges)
+        {
+            linkStart[edge.first + 1]++;
+            linkStart[edge.second + 1]++;
+        }
+
+        for(int room = 0; room < roomCount; room++)
+            linkStart[room + 1] += linkStart[room];
+
+        std::pmr::vector<std::pair<int, int>> links(linkStart.back(), scratch);
+        std::pmr::vector<int> cursor(linkStart.begin(), linkStart.end() - 1, scratch);
+        for(const auto& edge : edges)
+        {
+            const auto delta = centers[edge.first] - centers[edge.second];
+            const int length = std::abs(delta.x) + std::abs(delta.y);
+
+            links[cursor[edge.first]++] = {edge.second, length};
+            links[cursor[edge.second]++] = {edge.first, length};
+        }
+
+        // a Dijkstra from every room, first[room] is the first room after the source on the way to room
+        nextRooms.assign(std::size_t(roomCount) * roomCount, unreachable);
+
+        std::pmr::vector<int> distances(roomCount, 0, scratch);
+        std::pmr::vector<std::uint16_t> first(roomCount, 0, scratch);
+
+        using Entry = std::pair<int, int>;
+        std::priority_queue<Entry, std::pmr::vector<Entry>, std::greater<Entry>> queue{std::greater<Entry>(), std::pmr::vector<Entry>(scratch)};
+
+        for(int source = 0; source < roomCount; source++)
+        {
+            std::fill(distances.begin(), distances.end(), std::numeric_limits<int>::max());
+            std::fill(first.begin(), first.end(), unreachable);
+
+            distances[source] = 0;
+            first[source] = static_cast<std::uint16_t>(source);
+            queue.emplace(0, source);
+
+            while(!queue.empty())
+            {
+                const auto [distance, room] = queue.top();
+                queue.pop();
+
+                if(distance > distances[room])
+                    continue;
+
+                for(int link = linkStart[room]; link < linkStart[room + 1]; link++)
+                {
+                    const auto [neighbour, length] = links[link];
+
+                    const int next = distance + length;
+                    const auto hop = room == source ? static_cast<std::uint16_t>(neighbour) : first[room];
+
+                    // on a tie the lowest first room wins so the table doesn't depend on the edge order
+                    if(next < distances[neighbour] || (next == distances[neighbour] && hop < first[neighbour]))
+                    {
+                        distances[neighbour] = next;
+                        first[neighbour] = hop;
+                        queue.emplace(next, neighbour);
+                    }
+                }
+            }
+
+            std::copy(first.begin(), first.end(), nextRooms.begin() + std::size_t(source) * roomCount);
+        }
+
+        return true;
+    }
+
+    void clear()
+    {
+        roomCount = 0;
+        nextRooms.clear();
+        walkable.setSize({0, 0});
+        flowFields.clear();
+    }
+
+    int getRoomCount() const
+    {
+        return roomCount;
+    }
+
+    // room after from on the shortest path to to, to if they are the same, -1 if to can't be reached
+    int getNextRoom(int from, int to) const
+    {
+        const auto next = nextRooms[std::size_t(from) * roomCount + to];
+        return next == unreachable ? -1 : next;
+    }
+
+    // rooms from from to to, both included, empty if to can't be reached
+    void getRoomPath(int from, int to, std::vector<int>& path) const
+    {
+        path.clear();
+        if(getNextRoom(from, to) == -1)
+            return;
+
+        path.push_back(from);
+        while(from != to)
+        {
+            from = getNextRoom(from, to);
+            path.push_back(from);
+        }
+    }
+
+    bool isWalkable(const Vec2i& pos) const
+    {
+        const auto size = walkable.getSize();
+        return pos.x >= 0 && pos.y >= 0 && pos.x < size.x && pos.y < size.y && walkable.getTile(pos);
+    }
+
+    // the flow field to target, computed if it wasn't cached
+    const FlowField& getFlowField(const Vec2i& target)
+    {
+        for(const auto& field : flowFields)
+        {
+            if(field.target == target)
+                return field;
+        }
+
+        if(static_cast<int>(flowFields.size()) >= std::max(maxFlowFields, 1))
+            flowFields.pop_front();
+
+        flowFields.emplace_back();
+        computeFlowField(target, flowFields.back());
+
+        return flowFields.back();
+    }
+
+    // tile to walk to from from to get closer to target, from itself if it's there or can't reach it
+    Vec2i getNextStep(const Vec2i& from, const Vec2i& target)
+    {
+        return from + FlowField::toOffset(getFlowField(target).getStep(from));
+    }
+
+    void setMaxFlowFields(int count)
+    {
+        maxFlowFields = count;
+        while(static_cast<int>(flowFields.size()) > std::max(maxFlowFields, 1))
+            flowFields.pop_front();
+    }
+
+    int getCachedFlowFields() const
+    {
+        return static_cast<int>(flowFields.size());
+    }
+
+private:
+    void computeFlowField(const Vec2i& target, FlowField& field)
+    {
+        const auto size = walkable.getSize();
+
+        field.target = target;
+        field.size = size;
+        field.steps.assign((std::size_t(size.x) * size.y + 1) / 2, 0);
+
+        if(!isWalkable(target))
+            return;
+
+        // every tile reached steps back toward the tile it was reached from
+        queue.clear();
+
+        const int start = target.y * size.x + target.x;
+        field.setStep(start, FlowField::ARRIVED);
+        queue.push_back(start);
+
+        for(std::size_t read = 0; read < queue.size(); read++)
+        {
+            const int index = queue[read];
+            const Vec2i pos = {index % size.x, index / size.x};
+
+            auto visit = [&](const Vec2i& neighbour, FlowField::Step step)
+            {
+                if(!isWalkable(neighbour))
+                    return;
+
+                const int next = neighbour.y * size.x + neighbour.x;
+                if(field.getStep(neighbour) != FlowField::NONE)
+                    return;
+
+                field.setStep(next, step);
+                queue.push_back(next);
+            };
+
+            visit({pos.x, pos.y + 1}, FlowField::UP);
+            visit({pos.x, pos.y - 1}, FlowField::DOWN);
+            visit({pos.x + 1, pos.y}, FlowField::LEFT);
+            visit({pos.x - 1, pos.y}, FlowField::RIGHT);
+        }
+    }
+
+    int roomCount = 0;
+
+    // nextRooms[from * roomCount + to], room indices on 16 bits next to the unreachable marker
+    std::pmr::vector<std::uint16_t> nextRooms;
+
+    TileMap<bool> walkable;
+
+    int maxFlowFields = 16;
+    std::deque<FlowField> flowFields;
+
+    std::vector<int> queue; // tiles of the breadth first search, kept from one flow field to the next
+};
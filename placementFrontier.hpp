@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <memory_resource>
+
+#include "vector2.hpp"
+
+// For each side of the map, how far from that side the filled tiles stop being in the way.
+// Looking from the top, a column is clear from row getClearDistance(UP, column) to the bottom,
+// the last row excluded. Looking from the bottom it's clear from the top to
+// row size.y - 1 - getClearDistance(DOWN, column), the same goes for the left and right sides.
+// These are the sight lines checked when placing a room, a room can only be placed where
+// its lines are clear which gives the first row worth scanning without testing any tile.
+struct PlacementFrontier
+{
+    enum Side {UP, DOWN, LEFT, RIGHT};
+
+    static constexpr int never = std::numeric_limits<int>::max();
+
+    explicit PlacementFrontier(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) :
+        distances{std::pmr::vector<int>(resource), std::pmr::vector<int>(resource), std::pmr::vector<int>(resource), std::pmr::vector<int>(resource)}
+    {
+    }
+
+    void setSize(const Vec2i& size)
+    {
+        this->size = size;
+
+        distances[UP].assign(std::max(size.x, 0), 0);
+        distances[DOWN].assign(std::max(size.x, 0), 0);
+        distances[LEFT].assign(std::max(size.y, 0), 0);
+        distances[RIGHT].assign(std::max(size.y, 0), 0);
+    }
+
+    void fillRect(Vec2i pos, Vec2i size)
+    {
+        auto end = pos + size;
+
+        pos.x = std::max(pos.x, 0);
+        pos.y = std::max(pos.y, 0);
+        end.x = std::min(end.x, this->size.x);
+        end.y = std::min(end.y, this->size.y);
+
+        if(pos.x >= end.x || pos.y >= end.y)
+            return;
+
+        // the sight lines from the top and the left stop before the last row and column
+        const int lastRow = std::min(end.y, this->size.y - 1) - 1;
+        const int lastColumn = std::min(end.x, this->size.x - 1) - 1;
+
+        for(int x = pos.x; x < end.x; x++)
+        {
+            if(lastRow >= pos.y)
+                distances[UP][x] = std::max(distances[UP][x], lastRow + 1);
+
+            distances[DOWN][x] = std::max(distances[DOWN][x], this->size.y - 1 - pos.y);
+        }
+
+        for(int y = pos.y; y < end.y; y++)
+        {
+            if(lastColumn >= pos.x)
+                distances[LEFT][y] = std::max(distances[LEFT][y], lastColumn + 1);
+
+            distances[RIGHT][y] = std::max(distances[RIGHT][y], this->size.x - 1 - pos.x);
+        }
+    }
+
+    int getClearDistance(Side side, int line) const
+    {
+        return distances[side][line];
+    }
+
+    // Write in clear the distance from which the lines [line, line + width) are all clear, for
+    // every line of the side. Lines that don't fit before the last one are never clear
+    void getClearDistances(Side side, int width, std::pmr::vector<int>& clear) const
+    {
+        const auto& lines = distances[side];
+        const int count = lines.size();
+
+        clear.assign(count, never);
+        for(int line = 0; line + width <= count - 1; line++)
+        {
+            int distance = 0;
+            for(int x = line; x < line + width; x++)
+                distance = std::max(distance, lines[x]);
+
+            clear[line] = distance;
+        }
+    }
+
+private:
+    Vec2i size;
+
+    std::pmr::vector<int> distances[4];
+};
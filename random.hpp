@@ -0,0 +1,99 @@
+#pragma once
+
+#include <random>
+#include <cstdint>
+#include <limits>
+#include <initializer_list>
+
+// splitmix64 of the seed and the values, every value changes the whole hash
+inline std::uint64_t hashSeed(std::uint64_t seed, std::initializer_list<std::uint32_t> values)
+{
+    std::uint64_t value = seed * 0x9e3779b97f4a7c15ull;
+    for(const std::uint32_t part : values)
+    {
+        value += part + 0x9e3779b97f4a7c15ull;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        value ^= value >> 31;
+    }
+
+    return value;
+}
+
+// a seed from the system, for the dungeons generated with the seed -1
+inline std::uint32_t systemSeed()
+{
+    return std::random_device()();
+}
+
+// PCG32 (XSH RR), 64 bits of state and an odd increment selecting the stream.
+// A stream is derived from a seed and a few ids by hashing them, so each stage of the
+// generator and each room in it draws its own numbers: what one of them draws doesn't
+// depend on the others, on the order they run in or on the thread they run on.
+// Cheap to create, make one where it's needed instead of passing one around.
+class RandomStream
+{
+public:
+    using result_type = std::uint32_t;
+
+    RandomStream(std::uint64_t seed, std::initializer_list<std::uint32_t> ids)
+    {
+        increment = hashSeed(~seed, ids) << 1 | 1;
+        next();
+        state += hashSeed(seed, ids);
+        next();
+    }
+
+    static constexpr result_type min()
+    {
+        return 0;
+    }
+
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()()
+    {
+        return next();
+    }
+
+    // uniform in [min, max], without the modulo bias and nearly always without a division (Lemire)
+    int uniform(int min, int max)
+    {
+        const std::uint32_t range = std::uint32_t(max) - std::uint32_t(min) + 1;
+        if(range == 0)
+            return static_cast<int>(next());
+
+        std::uint64_t product = std::uint64_t(next()) * range;
+        std::uint32_t low = static_cast<std::uint32_t>(product);
+
+        if(low < range)
+        {
+            const std::uint32_t threshold = (0u - range) % range;
+            while(low < threshold)
+            {
+                product = std::uint64_t(next()) * range;
+                low = static_cast<std::uint32_t>(product);
+            }
+        }
+
+        return static_cast<int>(std::uint32_t(min) + static_cast<std::uint32_t>(product >> 32));
+    }
+
+private:
+    std::uint32_t next()
+    {
+        const std::uint64_t old = state;
+        state = old * 6364136223846793005ull + increment;
+
+        const std::uint32_t shifted = static_cast<std::uint32_t>(((old >> 18) ^ old) >> 27);
+        const std::uint32_t rotation = static_cast<std::uint32_t>(old >> 59);
+
+        return (shifted >> rotation) | (shifted << ((0u - rotation) & 31));
+    }
+
+    std::uint64_t state = 0;
+    std::uint64_t increment = 1;
+};
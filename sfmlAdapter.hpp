@@ -0,0 +1,35 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Graphics/Rect.hpp>
+
+#include "vector2.hpp"
+
+// Conversions between the generator types and SFML, only needed by the viewer
+
+inline sf::Vector2i toSfml(const Vec2i& v)
+{
+    return {v.x, v.y};
+}
+
+inline sf::Vector2f toSfmlFloat(const Vec2i& v)
+{
+    return {static_cast<float>(v.x), static_cast<float>(v.y)};
+}
+
+inline Vec2i fromSfml(const sf::Vector2i& v)
+{
+    return {v.x, v.y};
+}
+
+inline sf::FloatRect tileToRect(const Vec2i& pos, const sf::Vector2f& tileSize)
+{
+    sf::FloatRect rect;
+
+    rect.left = pos.x * tileSize.x;
+    rect.top = pos.y * tileSize.y;
+    rect.width = tileSize.x;
+    rect.height = tileSize.y;
+
+    return rect;
+}
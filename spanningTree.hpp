@@ -0,0 +1,167 @@
+#pragma once
+
+#include <queue>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <numeric>
+#include <algorithm>
+#include <functional>
+#include <memory_resource>
+
+#include "vector2.hpp"
+
+inline std::int64_t squaredDist(const Vec2i& v1, const Vec2i& v2)
+{
+    const std::int64_t dx = std::int64_t(v1.x) - v2.x;
+    const std::int64_t dy = std::int64_t(v1.y) - v2.y;
+    return dx*dx + dy*dy;
+}
+
+// Union-find with union by rank and path halving
+struct DisjointSet
+{
+    explicit DisjointSet(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : parents(resource), ranks(resource)
+    {
+    }
+
+    void reset(int count)
+    {
+        parents.resize(count);
+        std::iota(parents.begin(), parents.end(), 0);
+        ranks.assign(count, 0);
+    }
+
+    int find(int x)
+    {
+        while(parents[x] != x)
+        {
+            parents[x] = parents[parents[x]];
+            x = parents[x];
+        }
+
+        return x;
+    }
+
+    // return false if both were already in the same set
+    bool unite(int x, int y)
+    {
+        x = find(x);
+        y = find(y);
+
+        if(x == y)
+            return false;
+
+        if(ranks[x] < ranks[y])
+            std::swap(x, y);
+
+        parents[y] = x;
+        if(ranks[x] == ranks[y])
+            ranks[x]++;
+
+        return true;
+    }
+
+    std::pmr::vector<int> parents;
+    std::pmr::vector<int> ranks;
+};
+
+// Kruskal on edges given as indices in points, return the indices of the edges kept.
+// Ties on the length are broken by the edge index so the result doesn't depend on the sort.
+// The result and the temporary buffers are allocated from resource
+template <typename Points, typename Edges>
+std::pmr::vector<int> minimumSpanningTree(const Points& points, const Edges& edges, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+{
+    std::pmr::vector<std::pair<std::int64_t, int>> weightedEdges(resource);
+    weightedEdges.reserve(edges.size());
+    for(int x = 0; x < static_cast<int>(edges.size()); x++)
+        weightedEdges.emplace_back(squaredDist(points[edges[x].first], points[edges[x].second]), x);
+
+    std::sort(weightedEdges.begin(), weightedEdges.end());
+
+    DisjointSet sets(resource);
+    sets.reset(points.size());
+
+    std::pmr::vector<int> tree(resource);
+    for(const auto& edge : weightedEdges)
+    {
+        if(sets.unite(edges[edge.second].first, edges[edge.second].second))
+            tree.push_back(edge.second);
+
+        if(tree.size() + 1 == points.size())
+            break;
+    }
+
+    return tree;
+}
+
+// Prim on the adjacency of the edges, same result as Kruskal when no two edges have the same length.
+// Cheaper on sparse graphs like a triangulation since the edges don't need to be fully sorted
+template <typename Points, typename Edges>
+std::pmr::vector<int> primSpanningTree(const Points& points, const Edges& edges, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+{
+    const int count = points.size();
+
+    // edges around each point, packed by point
+    std::pmr::vector<int> offsets(count + 1, 0, resource);
+    for(const auto& edge : edges)
+    {
+        offsets[edge.first + 1]++;
+        offsets[edge.second + 1]++;
+    }
+
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    std::pmr::vector<int> adjacency(offsets.back(), resource);
+    std::pmr::vector<int> fill(offsets.begin(), offsets.end() - 1, resource);
+    for(int x = 0; x < static_cast<int>(edges.size()); x++)
+    {
+        adjacency[fill[edges[x].first]++] = x;
+        adjacency[fill[edges[x].second]++] = x;
+    }
+
+    using Candidate = std::pair<std::int64_t, int>;
+    std::priority_queue<Candidate, std::pmr::vector<Candidate>, std::greater<Candidate>> candidates{std::greater<Candidate>(), std::pmr::vector<Candidate>(resource)};
+
+    std::pmr::vector<bool> reached(count, false, resource);
+    std::pmr::vector<int> tree(resource);
+
+    auto reach = [&](int point)
+    {
+        reached[point] = true;
+
+        for(int x = offsets[point]; x < offsets[point + 1]; x++)
+        {
+            const auto& edge = edges[adjacency[x]];
+            const int other = edge.first == point ? edge.second : edge.first;
+
+            if(!reached[other])
+                candidates.emplace(squaredDist(points[edge.first], points[edge.second]), adjacency[x]);
+        }
+    };
+
+    // a forest if the edges don't connect every point
+    for(int root = 0; root < count; root++)
+    {
+        if(reached[root])
+            continue;
+
+        reach(root);
+
+        while(!candidates.empty())
+        {
+            const int index = candidates.top().second;
+            candidates.pop();
+
+            const auto& edge = edges[index];
+            const int next = reached[edge.first] ? edge.second : edge.first;
+            if(reached[next])
+                continue;
+
+            tree.push_back(index);
+            reach(next);
+        }
+    }
+
+    return tree;
+}
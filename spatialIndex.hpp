@@ -0,0 +1,377 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <memory_resource>
+
+#include "vector2.hpp"
+
+// Uniform grid of cellSize x cellSize tiles over a list of rects, each cell lists the rects overlapping it.
+// The lists are stored one after the other, the rects of cell c are items[cellStart[c], cellStart[c + 1])
+class RectGrid
+{
+public:
+    explicit RectGrid(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) :
+        rects(resource), cellStart(resource), items(resource), cursor(resource)
+    {
+    }
+
+    // rects are given as [pos, pos + size), a negative size extends the rect before pos
+    template <typename Rects, typename GetRect>
+    void build(const Vec2i& mapSize, int cellSize, const Rects& source, GetRect getRect)
+    {
+        this->cellSize = std::max(cellSize, 1);
+        cells = {(std::max(mapSize.x, 1) + this->cellSize - 1) / this->cellSize, (std::max(mapSize.y, 1) + this->cellSize - 1) / this->cellSize};
+
+        rects.clear();
+        for(const auto& item : source)
+        {
+            Vec2i pos, size;
+            getRect(item, pos, size);
+
+            if(size.x < 0)
+            {
+                size.x = -size.x;
+                pos.x -= size.x;
+            }
+
+            if(size.y < 0)
+            {
+                size.y = -size.y;
+                pos.y -= size.y;
+            }
+
+            rects.push_back({pos, pos + size});
+        }
+
+        // count the rects of every cell, turn the counts in offsets then fill the cells
+        cellStart.assign(cells.x * cells.y + 1, 0);
+        for(const auto& rect : rects)
+            forEachCell(rect.begin, rect.end, [&](int cell){cellStart[cell + 1]++;});
+
+        for(std::size_t cell = 1; cell < cellStart.size(); cell++)
+            cellStart[cell] += cellStart[cell - 1];
+
+        items.resize(cellStart.back());
+
+        cursor.assign(cellStart.begin(), cellStart.end() - 1);
+        for(int index = 0; index < static_cast<int>(rects.size()); index++)
+            forEachCell(rects[index].begin, rects[index].end, [&](int cell){items[cursor[cell]++] = index;});
+    }
+
+    // no rects and no cells, every query finds nothing
+    void clear()
+    {
+        cells = {};
+        rects.clear();
+        cellStart.clear();
+        items.clear();
+    }
+
+    int size() const
+    {
+        return static_cast<int>(rects.size());
+    }
+
+    // index of the first rect containing pos, -1 if there is none
+    int at(const Vec2i& pos) const
+    {
+        const int cell = cellOf(pos);
+        if(cell == -1)
+            return -1;
+
+        for(int item = cellStart[cell]; item < cellStart[cell + 1]; item++)
+        {
+            const auto& rect = rects[items[item]];
+            if(pos.x >= rect.begin.x && pos.y >= rect.begin.y && pos.x < rect.end.x && pos.y < rect.end.y)
+                return items[item];
+        }
+
+        return -1;
+    }
+
+    // true if no rect overlaps the cell of pos, which is then skipped without testing any rect
+    bool isCellEmpty(const Vec2i& pos) const
+    {
+        const int cell = cellOf(pos);
+        return cell == -1 || cellStart[cell] == cellStart[cell + 1];
+    }
+
+    // call function(index) once for every rect overlapping [pos, pos + size)
+    template <typename Function>
+    void forEachInRect(const Vec2i& pos, const Vec2i& size, Function function) const
+    {
+        const Vec2i end = pos + size;
+
+        forEachCell(pos, end, [&](int cell)
+        {
+            for(int item = cellStart[cell]; item < cellStart[cell + 1]; item++)
+            {
+                const auto& rect = rects[items[item]];
+
+                // the overlap is reported by the cell holding its top left corner only
+                const Vec2i first = {std::max(rect.begin.x, pos.x), std::max(rect.begin.y, pos.y)};
+                const Vec2i last = {std::min(rect.end.x, end.x), std::min(rect.end.y, end.y)};
+
+                if(first.x >= last.x || first.y >= last.y)
+                    continue;
+
+                if(clampedCellOf(first) == cell)
+                    function(items[item]);
+            }
+        });
+    }
+
+    // Index of the rect whose center (pos + size/2) is the closest to pos, the first one on a tie.
+    // Scans rings of cells around pos until no closer center can be in the next one. -1 if there are no rects
+    int nearestCenter(const Vec2i& pos) const
+    {
+        if(rects.empty())
+            return -1;
+
+        const Vec2i origin = {std::clamp(floorDiv(pos.x), 0, cells.x - 1), std::clamp(floorDiv(pos.y), 0, cells.y - 1)};
+        const int rings = std::max({origin.x, origin.y, cells.x - 1 - origin.x, cells.y - 1 - origin.y});
+
+        int best = -1;
+        std::int64_t bestDistance = 0;
+
+        for(int ring = 0; ring <= rings; ring++)
+        {
+            // every cell of this ring is at least ring - 1 cells away
+            const std::int64_t bound = std::int64_t(std::max(ring - 1, 0)) * cellSize;
+            if(best != -1 && bestDistance < bound * bound)
+                break;
+
+            for(int y = origin.y - ring; y <= origin.y + ring; y++)
+            {
+                if(y < 0 || y >= cells.y)
+                    continue;
+
+                const bool edge = y == origin.y - ring || y == origin.y + ring;
+                for(int x = origin.x - ring; x <= origin.x + ring; x += edge ? 1 : ring * 2)
+                {
+                    if(x >= 0 && x < cells.x)
+                        nearestInCell(y * cells.x + x, pos, best, bestDistance);
+
+                    if(ring == 0)
+                        break;
+                }
+            }
+        }
+
+        return best;
+    }
+
+    Vec2i getBegin(int index) const
+    {
+        return rects[index].begin;
+    }
+
+    Vec2i getEnd(int index) const
+    {
+        return rects[index].end;
+    }
+
+private:
+    struct Rect
+    {
+        Vec2i begin;
+        Vec2i end;
+    };
+
+    int floorDiv(int value) const
+    {
+        return value / cellSize - (value % cellSize != 0 && value < 0);
+    }
+
+    int cellOf(const Vec2i& pos) const
+    {
+        if(pos.x < 0 || pos.y < 0)
+            return -1;
+
+        const Vec2i cell = {pos.x / cellSize, pos.y / cellSize};
+        if(cell.x >= cells.x || cell.y >= cells.y)
+            return -1;
+
+        return cell.y * cells.x + cell.x;
+    }
+
+    // cell of pos, or the closest one if it's off the grid
+    int clampedCellOf(const Vec2i& pos) const
+    {
+        return std::clamp(floorDiv(pos.y), 0, cells.y - 1) * cells.x + std::clamp(floorDiv(pos.x), 0, cells.x - 1);
+    }
+
+    // call function(cell) for every cell overlapping [begin, end), clipped to the grid
+    template <typename Function>
+    void forEachCell(const Vec2i& begin, const Vec2i& end, Function function) const
+    {
+        if(begin.x >= end.x || begin.y >= end.y)
+            return;
+
+        const int firstX = std::max(floorDiv(begin.x), 0);
+        const int firstY = std::max(floorDiv(begin.y), 0);
+        const int lastX = std::min(floorDiv(end.x - 1), cells.x - 1);
+        const int lastY = std::min(floorDiv(end.y - 1), cells.y - 1);
+
+        for(int y = firstY; y <= lastY; y++)
+        {
+            for(int x = firstX; x <= lastX; x++)
+                function(y * cells.x + x);
+        }
+    }
+
+    // a center is only looked at in the cell holding it, or the closest one if it's off the grid
+    void nearestInCell(int cell, const Vec2i& pos, int& best, std::int64_t& bestDistance) const
+    {
+        for(int item = cellStart[cell]; item < cellStart[cell + 1]; item++)
+        {
+            const int index = items[item];
+            const auto& rect = rects[index];
+            const Vec2i center = rect.begin + (rect.end - rect.begin)/2;
+
+            if(clampedCellOf(center) != cell)
+                continue;
+
+            const auto delta = center - pos;
+            const std::int64_t distance = std::int64_t(delta.x) * delta.x + std::int64_t(delta.y) * delta.y;
+
+            if(best == -1 || distance < bestDistance || (distance == bestDistance && index < best))
+            {
+                best = index;
+                bestDistance = distance;
+            }
+        }
+    }
+
+    int cellSize = 1;
+    Vec2i cells;
+
+    std::pmr::vector<Rect> rects;
+    std::pmr::vector<int> cellStart;
+    std::pmr::vector<int> items;
+
+    std::pmr::vector<int> cursor; // next free item of every cell while building
+};
+
+// Rooms and corridors of a dungeon in uniform grids. Tells which room or corridor a tile is in
+// in O(1) and finds the rooms overlapping a rect, crossed by a line or closest to a tile
+// without going through all of them. Indices are the ones in Dungeon::rooms and Dungeon::corridors
+struct SpatialIndex
+{
+    static constexpr int cellSize = 8;
+
+    explicit SpatialIndex(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : rooms(resource), corridors(resource)
+    {
+    }
+
+    template <typename Rooms, typename Corridors>
+    void build(const Vec2i& mapSize, const Rooms& roomList, const Corridors& corridorList)
+    {
+        rooms.build(mapSize, cellSize, roomList, [](const auto& room, Vec2i& pos, Vec2i& size)
+        {
+            pos = room.pos;
+            size = room.size;
+        });
+
+        corridors.build(mapSize, cellSize, corridorList, [](const auto& corridor, Vec2i& pos, Vec2i& size)
+        {
+            pos = corridor.start;
+            size = corridor.end - corridor.start;
+        });
+    }
+
+    void clear()
+    {
+        rooms.clear();
+        corridors.clear();
+    }
+
+    // -1 outside of any room
+    int roomAt(const Vec2i& pos) const
+    {
+        return rooms.at(pos);
+    }
+
+    // -1 outside of any corridor
+    int corridorAt(const Vec2i& pos) const
+    {
+        return corridors.at(pos);
+    }
+
+    template <typename Function>
+    void forEachRoomInRect(const Vec2i& pos, const Vec2i& size, Function function) const
+    {
+        rooms.forEachInRect(pos, size, function);
+    }
+
+    template <typename Function>
+    void forEachCorridorInRect(const Vec2i& pos, const Vec2i& size, Function function) const
+    {
+        corridors.forEachInRect(pos, size, function);
+    }
+
+    // room whose center (pos + size/2) is the closest to pos, -1 if there are no rooms
+    int nearestRoom(const Vec2i& pos) const
+    {
+        return rooms.nearestCenter(pos);
+    }
+
+    // First room on the tiles of the line from from to to, both included, -1 if it doesn't cross any.
+    // hit gets the first tile of the line in that room
+    int firstRoomOnLine(const Vec2i& from, const Vec2i& to, Vec2i* hit = nullptr) const
+    {
+        const Vec2i delta = {std::abs(to.x - from.x), -std::abs(to.y - from.y)};
+        const Vec2i step = {from.x < to.x ? 1 : -1, from.y < to.y ? 1 : -1};
+
+        Vec2i pos = from;
+        int error = delta.x + delta.y;
+
+        while(true)
+        {
+            if(!rooms.isCellEmpty(pos))
+            {
+                const int room = rooms.at(pos);
+                if(room != -1)
+                {
+                    if(hit)
+                        *hit = pos;
+
+                    return room;
+                }
+            }
+
+            if(pos == to)
+                return -1;
+
+            const int doubled = error * 2;
+            if(doubled >= delta.y)
+            {
+                error += delta.y;
+                pos.x += step.x;
+            }
+
+            if(doubled <= delta.x)
+            {
+                error += delta.x;
+                pos.y += step.y;
+            }
+        }
+    }
+
+    const RectGrid& getRooms() const
+    {
+        return rooms;
+    }
+
+    const RectGrid& getCorridors() const
+    {
+        return corridors;
+    }
+
+private:
+    RectGrid rooms;
+    RectGrid corridors;
+};
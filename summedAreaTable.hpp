@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <memory_resource>
+
+#include "vector2.hpp"
+
+// 2D prefix sums of the filled tiles, answers "how many tiles are filled in this rect" in O(1).
+// Filling a rect only updates the sums below and right of it, tiles filled several
+// times are counted several times which doesn't matter to know if a rect is empty
+struct SummedAreaTable
+{
+    explicit SummedAreaTable(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : sums(resource)
+    {
+    }
+
+    void setSize(const Vec2i& size)
+    {
+        width = size.x;
+        height = size.y;
+        sums.assign((width + 1) * (height + 1), 0);
+    }
+
+    Vec2i getSize() const
+    {
+        return {width, height};
+    }
+
+    void fillRect(Vec2i pos, Vec2i size)
+    {
+        auto end = pos + size;
+
+        pos.x = std::max(pos.x, 0);
+        pos.y = std::max(pos.y, 0);
+        end.x = std::min(end.x, width);
+        end.y = std::min(end.y, height);
+
+        if(pos.x >= end.x || pos.y >= end.y)
+            return;
+
+        for(int y = pos.y + 1; y <= height; y++)
+        {
+            const std::uint32_t rows = std::min(y, end.y) - pos.y;
+            std::uint32_t* row = &sums[y * (width + 1)];
+
+            for(int x = pos.x + 1; x <= width; x++)
+                row[x] += rows * (std::min(x, end.x) - pos.x);
+        }
+    }
+
+    // rect must be inside the table
+    std::uint32_t count(const Vec2i& pos, const Vec2i& size) const
+    {
+        const int stride = width + 1;
+        const int top = pos.y * stride;
+        const int bottom = (pos.y + size.y) * stride;
+
+        return sums[bottom + pos.x + size.x] - sums[bottom + pos.x] - sums[top + pos.x + size.x] + sums[top + pos.x];
+    }
+
+    bool isEmpty(const Vec2i& pos, const Vec2i& size) const
+    {
+        return count(pos, size) == 0;
+    }
+
+private:
+    int width = 0;
+    int height = 0;
+
+    // sums[y * (width + 1) + x] is the count for the rect from (0, 0) to (x, y) excluded
+    std::pmr::vector<std::uint32_t> sums;
+};
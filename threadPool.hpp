@@ -0,0 +1,198 @@
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+
+// Work stealing thread pool.
+//
+// Each worker has its own queue, it takes tasks from the back of it and steals
+// from the front of the others when it's empty. Tasks submitted from a worker go
+// to its own queue, the others are spread over all the queues.
+// The thread waiting in parallelFor runs tasks too instead of sleeping.
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+    // 0 to use a thread per core
+    explicit ThreadPool(int threadCount = 0)
+    {
+        if(threadCount <= 0)
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+        queueCount = threadCount;
+        queues.reset(new Queue[queueCount]);
+
+        for(int x = 0; x < threadCount; x++)
+            workers.emplace_back([this, x]{work(x);});
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+
+        wakeUp.notify_all();
+
+        for(auto& worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const
+    {
+        return static_cast<int>(workers.size());
+    }
+
+    // index of the calling worker in [0, size()), -1 if it isn't a worker of this pool
+    int workerIndex() const
+    {
+        return currentPool == this ? currentIndex : -1;
+    }
+
+    void submit(Task task)
+    {
+        int index = workerIndex();
+        if(index == -1)
+            index = nextQueue++ % queueCount;
+
+        {
+            std::lock_guard<std::mutex> lock(queues[index].mutex);
+            queues[index].tasks.push_back(std::move(task));
+        }
+
+        queued++;
+
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+
+        wakeUp.notify_one();
+    }
+
+    // call function(index) for every index in [begin, end), grain indices per task,
+    // and return once they are all done
+    template <typename Function>
+    void parallelFor(int begin, int end, Function function, int grain = 1)
+    {
+        if(begin >= end)
+            return;
+
+        grain = std::max(grain, 1);
+
+        std::atomic<int> remaining((end - begin + grain - 1) / grain);
+
+        for(int first = begin; first < end; first += grain)
+        {
+            const int last = std::min(first + grain, end);
+
+            submit([&function, &remaining, first, last]
+            {
+                for(int index = first; index < last; index++)
+                    function(index);
+
+                remaining--;
+            });
+        }
+
+        while(remaining > 0)
+        {
+            if(!runPending())
+                std::this_thread::yield();
+        }
+    }
+
+    // run one queued task on the calling thread, return false if there was none
+    bool runPending()
+    {
+        Task task;
+        if(!take(std::max(workerIndex(), 0), task))
+            return false;
+
+        task();
+        return true;
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // own queue first, then steal from the others
+    bool take(int index, Task& task)
+    {
+        for(int x = 0; x < queueCount; x++)
+        {
+            auto& queue = queues[(index + x) % queueCount];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+
+            if(queue.tasks.empty())
+                continue;
+
+            if(x == 0)
+            {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+            else
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+
+            queued--;
+            return true;
+        }
+
+        return false;
+    }
+
+    void work(int index)
+    {
+        currentPool = this;
+        currentIndex = index;
+
+        while(true)
+        {
+            Task task;
+            if(take(index, task))
+            {
+                task();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wakeUp.wait(lock, [this]{return stopping || queued > 0;});
+
+            if(stopping && queued == 0)
+                return;
+        }
+    }
+
+    static inline thread_local ThreadPool* currentPool = nullptr;
+    static inline thread_local int currentIndex = -1;
+
+    int queueCount = 0;
+    std::unique_ptr<Queue[]> queues;
+    std::vector<std::thread> workers;
+
+    std::atomic<int> queued = {0};
+    std::atomic<unsigned> nextQueue = {0};
+
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    bool stopping = false;
+};
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TILE_KERNELS_X86 1
+#include <immintrin.h>
+#else
+#define TILE_KERNELS_X86 0
+#endif
+
+#if defined(_MSC_VER)
+#define TILE_KERNELS_NOINLINE __declspec(noinline)
+#elif defined(__GNUC__)
+#define TILE_KERNELS_NOINLINE __attribute__((noinline))
+#else
+#define TILE_KERNELS_NOINLINE
+#endif
+
+// Kernels looking for the first byte of a run that isn't a given value, a vector register at
+// a time. The first call picks the widest one the cpu runs (AVX2, SSE2 or 64 bits words) so
+// one binary runs everywhere. They work on bytes, the byte tiles and the words of the bitmaps
+// go through the same ones
+namespace tileKernels
+{
+    namespace detail
+    {
+        inline std::size_t findScalar(const std::uint8_t* data, std::size_t size, std::uint8_t value)
+        {
+            const std::uint64_t pattern = value * 0x0101010101010101ull;
+
+            std::size_t x = 0;
+            for(; x + 8 <= size; x += 8)
+            {
+                std::uint64_t word;
+                std::memcpy(&word, data + x, 8);
+                if(word != pattern)
+                    break;
+            }
+
+            for(; x < size; x++)
+            {
+                if(data[x] != value)
+                    return x;
+            }
+
+            return size;
+        }
+
+#if TILE_KERNELS_X86
+        __attribute__((target("sse2")))
+        inline std::size_t findSse2(const std::uint8_t* data, std::size_t size, std::uint8_t value)
+        {
+            const __m128i pattern = _mm_set1_epi8(static_cast<char>(value));
+
+            std::size_t x = 0;
+            for(; x + 16 <= size; x += 16)
+            {
+                const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + x));
+                const int same = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, pattern));
+                if(same != 0xffff)
+                    return x + __builtin_ctz(~same);
+            }
+
+            return x + findScalar(data + x, size - x, value);
+        }
+
+        // 128 bytes per test, the comparisons are and'ed together and only looked
+        // at one by one once they tell there's a different byte
+        __attribute__((target("avx2")))
+        inline std::size_t findAvx2(const std::uint8_t* data, std::size_t size, std::uint8_t value)
+        {
+            const __m256i pattern = _mm256_set1_epi8(static_cast<char>(value));
+            const auto* vectors = reinterpret_cast<const __m256i*>(data);
+
+            std::size_t x = 0;
+            for(; x + 128 <= size; x += 128, vectors += 4)
+            {
+                const __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256(vectors), pattern);
+                const __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256(vectors + 1), pattern);
+                const __m256i c = _mm256_cmpeq_epi8(_mm256_loadu_si256(vectors + 2), pattern);
+                const __m256i d = _mm256_cmpeq_epi8(_mm256_loadu_si256(vectors + 3), pattern);
+
+                if(_mm256_movemask_epi8(_mm256_and_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, d))) != -1)
+                    break;
+            }
+
+            for(; x + 32 <= size; x += 32, vectors++)
+            {
+                const unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(vectors), pattern));
+                if(mask != 0xffffffffu)
+                    return x + __builtin_ctz(~mask);
+            }
+
+            return x + findScalar(data + x, size - x, value);
+        }
+#endif
+
+        using FindFunction = std::size_t (*)(const std::uint8_t*, std::size_t, std::uint8_t);
+
+        inline FindFunction selectFind()
+        {
+#if TILE_KERNELS_X86
+            __builtin_cpu_init();
+
+            if(__builtin_cpu_supports("avx2"))
+                return findAvx2;
+
+            if(__builtin_cpu_supports("sse2"))
+                return findSse2;
+#endif
+            return findScalar;
+        }
+
+        inline FindFunction getFind()
+        {
+            static const FindFunction function = selectFind();
+            return function;
+        }
+    }
+
+    struct Kernel
+    {
+        const char* name;
+        detail::FindFunction find;
+    };
+
+    // every kernel this cpu runs, the widest first, to test and time them against each other
+    inline std::vector<Kernel> getKernels()
+    {
+        std::vector<Kernel> kernels;
+
+#if TILE_KERNELS_X86
+        __builtin_cpu_init();
+
+        if(__builtin_cpu_supports("avx2"))
+            kernels.push_back({"avx2", detail::findAvx2});
+
+        if(__builtin_cpu_supports("sse2"))
+            kernels.push_back({"sse2", detail::findSse2});
+#endif
+
+        kernels.push_back({"scalar", detail::findScalar});
+        return kernels;
+    }
+
+    // name of the kernel picked for this cpu
+    inline const char* getName()
+    {
+        for(const auto& kernel : getKernels())
+        {
+            if(kernel.find == detail::getFind())
+                return kernel.name;
+        }
+
+        return "scalar";
+    }
+
+    // Offset of the first of the size bytes from data that isn't value, size if they all are.
+    // Kept out of line so the loops calling it stay as tight as without it
+    TILE_KERNELS_NOINLINE inline std::size_t findDifferent(const void* data, std::size_t size, std::uint8_t value)
+    {
+        return detail::getFind()(static_cast<const std::uint8_t*>(data), size, value);
+    }
+
+    // true if one of the size bytes from data isn't zero
+    inline bool anyNonZero(const void* data, std::size_t size)
+    {
+        return findDifferent(data, size, 0) != size;
+    }
+}
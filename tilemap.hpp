@@ -1,50 +1,410 @@
 #pragma once
 
 #include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+#include <memory_resource>
+
+#include "vector2.hpp"
+#include "tileKernels.hpp"
 
 template <typename TileType>
 struct TileMap
 {
-    void setSize(const sf::Vector2i& size)
+    explicit TileMap(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : tiles(resource)
+    {
+    }
+
+    void setSize(const Vec2i& size)
     {
         tiles.resize(size.x * size.y);
         width = size.x;
     }
 
-    sf::Vector2i getSize() const
+    Vec2i getSize() const
     {
-        return {width, static_cast<int>(tiles.size())/width};
+        return {width, width ? static_cast<int>(tiles.size())/width : 0};
     }
 
-    void setTile(const sf::Vector2i& pos, const TileType tile)
+    void setTile(const Vec2i& pos, const TileType tile)
     {
         tiles[pos.y * width + pos.x] = tile;
     }
 
-    TileType getTile(const sf::Vector2i& pos) const
+    TileType getTile(const Vec2i& pos) const
     {
         return tiles[pos.y * width + pos.x];
     }
 
-    TileType& at(const sf::Vector2i& pos)
+    TileType& at(const Vec2i& pos)
     {
         return tiles[pos.y * width + pos.x];
     }
 
-    static sf::FloatRect tileToRect(const sf::Vector2i& pos, const sf::Vector2f& tileSize)
+    // The rect functions clip the rect to the map
+
+    void fillRect(Vec2i pos, Vec2i size, const TileType tile)
+    {
+        if(!clip(pos, size))
+            return;
+
+        for(int y = pos.y; y < pos.y + size.y; y++)
+            std::fill_n(tiles.begin() + y * width + pos.x, size.x, tile);
+    }
+
+    // true if a tile in the rect isn't the default tile
+    bool anyInRect(Vec2i pos, Vec2i size) const
+    {
+        if(!clip(pos, size))
+            return false;
+
+        for(int y = pos.y; y < pos.y + size.y; y++)
+        {
+            const auto row = tiles.begin() + y * width + pos.x;
+
+            // the default of an integer or an enum is all zero bytes, the kernels test them
+            if constexpr(std::is_integral<TileType>::value || std::is_enum<TileType>::value)
+            {
+                if(tileKernels::anyNonZero(&*row, size.x * sizeof(TileType)))
+                    return true;
+            }
+            else if(std::any_of(row, row + size.x, [](const TileType& tile){return tile != TileType();}))
+                return true;
+        }
+
+        return false;
+    }
+
+    // number of tiles in the rect that aren't the default tile
+    int countInRect(Vec2i pos, Vec2i size) const
     {
-        sf::FloatRect rect;
+        if(!clip(pos, size))
+            return 0;
 
-        rect.left = pos.x * tileSize.x;
-        rect.top = pos.y * tileSize.y;
-        rect.width = tileSize.x;
-        rect.height = tileSize.y;
+        int count = 0;
+        for(int y = pos.y; y < pos.y + size.y; y++)
+        {
+            const auto row = tiles.begin() + y * width + pos.x;
+            count += std::count_if(row, row + size.x, [](const TileType& tile){return tile != TileType();});
+        }
 
-        return rect;
+        return count;
     }
 
-    std::vector<TileType> tiles;
+    // call function(begin, end, tile) for each run of identical tiles of the row
+    template <typename Function>
+    void forEachRun(int y, Function function) const
+    {
+        const TileType* row = tiles.data() + y * width;
+
+        for(int x = 0; x < width;)
+        {
+            const TileType tile = row[x];
+
+            // byte tiles are compared by the kernels
+            int end = x + 1;
+            if constexpr(sizeof(TileType) == 1 && (std::is_integral<TileType>::value || std::is_enum<TileType>::value))
+                end += tileKernels::findDifferent(row + end, width - end, static_cast<std::uint8_t>(tile));
+            else
+            {
+                while(end < width && row[end] == tile)
+                    end++;
+            }
+
+            function(x, end, tile);
+            x = end;
+        }
+    }
+
+    std::pmr::vector<TileType> tiles;
 
 private:
-    int width;
+    bool clip(Vec2i& pos, Vec2i& size) const
+    {
+        const auto mapSize = getSize();
+
+        auto end = pos + size;
+        pos.x = std::max(pos.x, 0);
+        pos.y = std::max(pos.y, 0);
+        end.x = std::min(end.x, mapSize.x);
+        end.y = std::min(end.y, mapSize.y);
+
+        size = end - pos;
+        return size.x > 0 && size.y > 0;
+    }
+
+    int width = 0;
+};
+
+// Bitmap of 64 bits words, each row starts on a new word and rows are padded to
+// 256 bits so rect operations work a whole word (or a vector register) at a time
+template <>
+struct TileMap<bool>
+{
+    using Word = std::uint64_t;
+
+    static constexpr int wordBits = 64;
+    static constexpr int rowAlignment = 4; // in words
+
+    explicit TileMap(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : words(resource)
+    {
+    }
+
+    void setSize(const Vec2i& size)
+    {
+        width = size.x;
+        height = size.y;
+        stride = ((width + wordBits - 1) / wordBits + rowAlignment - 1) / rowAlignment * rowAlignment;
+        words.assign(stride * height, 0);
+    }
+
+    Vec2i getSize() const
+    {
+        return {width, height};
+    }
+
+    void setTile(const Vec2i& pos, const bool tile)
+    {
+        Word& word = row(pos.y)[pos.x / wordBits];
+        const Word bit = Word(1) << (pos.x % wordBits);
+
+        word = tile ? word | bit : word & ~bit;
+    }
+
+    bool getTile(const Vec2i& pos) const
+    {
+        return row(pos.y)[pos.x / wordBits] >> (pos.x % wordBits) & 1;
+    }
+
+    // The rect functions clip the rect to the map
+
+    void fillRect(Vec2i pos, Vec2i size, const bool tile = true)
+    {
+        if(!clip(pos, size))
+            return;
+
+        const Word fill = tile ? ~Word(0) : 0;
+
+        for(int y = pos.y; y < pos.y + size.y; y++)
+        {
+            forEachEdgeWord(row(y), pos.x, pos.x + size.x, [tile](Word& word, Word mask)
+            {
+                word = tile ? word | mask : word & ~mask;
+            },
+            [fill](Word* words, int count)
+            {
+                std::fill_n(words, count, fill);
+            });
+        }
+    }
+
+    bool anyInRect(Vec2i pos, Vec2i size) const
+    {
+        if(!clip(pos, size))
+            return false;
+
+        for(int y = pos.y; y < pos.y + size.y; y++)
+        {
+            bool any = false;
+            forEachEdgeWord(row(y), pos.x, pos.x + size.x, [&any](const Word& word, Word mask)
+            {
+                any |= (word & mask) != 0;
+            },
+            [&any](const Word* words, int count)
+            {
+                any = any || tileKernels::anyNonZero(words, count * sizeof(Word));
+            });
+
+            if(any)
+                return true;
+        }
+
+        return false;
+    }
+
+    int countInRect(Vec2i pos, Vec2i size) const
+    {
+        if(!clip(pos, size))
+            return 0;
+
+        int count = 0;
+        for(int y = pos.y; y < pos.y + size.y; y++)
+        {
+            forEachWord(row(y), pos.x, pos.x + size.x, [&count](const Word& word, Word mask)
+            {
+                count += popcount(word & mask);
+            });
+        }
+
+        return count;
+    }
+
+    // call function(begin, end, tile) for each run of identical tiles of the row
+    template <typename Function>
+    void forEachRun(int y, Function function) const
+    {
+        for(int x = 0; x < width;)
+        {
+            const bool tile = getTile({x, y});
+            const int end = findNext(y, x, !tile);
+
+            function(x, end, tile);
+            x = end;
+        }
+    }
+
+    // call function(begin, end) for each run of set tiles of the row
+    template <typename Function>
+    void forEachSpan(int y, Function function) const
+    {
+        for(int x = findNext(y, 0, true); x < width; x = findNext(y, x, true))
+        {
+            const int end = findNext(y, x, false);
+
+            function(x, end);
+            x = end;
+        }
+    }
+
+    // first x >= from with the given value, width if there is none
+    int findNext(int y, int from, bool tile) const
+    {
+        if(from >= width)
+            return width;
+
+        const Word* bits = row(y);
+        const Word invert = tile ? 0 : ~Word(0);
+
+        const int last = (width - 1) / wordBits;
+
+        int index = from / wordBits;
+        Word word = (bits[index] ^ invert) & (~Word(0) << (from % wordBits));
+
+        // most runs end within a few words, the kernels skip the longer ones a vector at a time
+        for(int step = 0; !word && step < 4; step++)
+        {
+            if(++index > last)
+                return width;
+
+            word = bits[index] ^ invert;
+        }
+
+        if(!word)
+        {
+            const int words = last - index;
+            const int skipped = tileKernels::findDifferent(bits + index + 1, words * sizeof(Word), tile ? 0 : 0xff) / sizeof(Word);
+            if(skipped == words)
+                return width;
+
+            index += skipped + 1;
+            word = bits[index] ^ invert;
+        }
+
+        return std::min(index * wordBits + countTrailingZeros(word), width);
+    }
+
+    Word* row(int y)
+    {
+        return words.data() + y * stride;
+    }
+
+    const Word* row(int y) const
+    {
+        return words.data() + y * stride;
+    }
+
+    // words per row
+    int getStride() const
+    {
+        return stride;
+    }
+
+    static int popcount(Word word)
+    {
+#if defined(__GNUC__)
+        return __builtin_popcountll(word);
+#else
+        int count = 0;
+        for(; word; word &= word - 1)
+            count++;
+        return count;
+#endif
+    }
+
+    static int countTrailingZeros(Word word)
+    {
+#if defined(__GNUC__)
+        return __builtin_ctzll(word);
+#else
+        int count = 0;
+        for(; !(word & 1); word >>= 1)
+            count++;
+        return count;
+#endif
+    }
+
+private:
+    // call function(word, mask) for each word holding tiles of [begin, end) with the mask of those tiles
+    template <typename RowWord, typename Function>
+    static void forEachWord(RowWord* words, int begin, int end, Function function)
+    {
+        const int first = begin / wordBits;
+        const int last = (end - 1) / wordBits;
+
+        const Word firstMask = ~Word(0) << (begin % wordBits);
+        const Word lastMask = ~Word(0) >> (wordBits - 1 - (end - 1) % wordBits);
+
+        if(first == last)
+        {
+            function(words[first], firstMask & lastMask);
+            return;
+        }
+
+        function(words[first], firstMask);
+        for(int index = first + 1; index < last; index++)
+            function(words[index], ~Word(0));
+        function(words[last], lastMask);
+    }
+
+    // Same as forEachWord but the whole words between the first and the last one are handed
+    // to inner(words, count) at once, to fill or test them with the vector kernels
+    template <typename RowWord, typename Edge, typename Inner>
+    static void forEachEdgeWord(RowWord* words, int begin, int end, Edge edge, Inner inner)
+    {
+        const int first = begin / wordBits;
+        const int last = (end - 1) / wordBits;
+
+        const Word firstMask = ~Word(0) << (begin % wordBits);
+        const Word lastMask = ~Word(0) >> (wordBits - 1 - (end - 1) % wordBits);
+
+        if(first == last)
+        {
+            edge(words[first], firstMask & lastMask);
+            return;
+        }
+
+        edge(words[first], firstMask);
+        if(last - first > 1)
+            inner(words + first + 1, last - first - 1);
+        edge(words[last], lastMask);
+    }
+
+    bool clip(Vec2i& pos, Vec2i& size) const
+    {
+        auto end = pos + size;
+        pos.x = std::max(pos.x, 0);
+        pos.y = std::max(pos.y, 0);
+        end.x = std::min(end.x, width);
+        end.y = std::min(end.y, height);
+
+        size = end - pos;
+        return size.x > 0 && size.y > 0;
+    }
+
+    int width = 0;
+    int height = 0;
+    int stride = 0;
+
+    std::pmr::vector<Word> words;
 };
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+// Integer 2D vector used by the generator, so it doesn't depend on any library
+struct Vec2i
+{
+    int x = 0;
+    int y = 0;
+
+    constexpr Vec2i() = default;
+
+    constexpr Vec2i(int x, int y) : x(x), y(y)
+    {
+    }
+
+    constexpr Vec2i& operator += (const Vec2i& v)
+    {
+        x += v.x;
+        y += v.y;
+        return *this;
+    }
+
+    constexpr Vec2i& operator -= (const Vec2i& v)
+    {
+        x -= v.x;
+        y -= v.y;
+        return *this;
+    }
+
+    constexpr Vec2i& operator *= (int value)
+    {
+        x *= value;
+        y *= value;
+        return *this;
+    }
+
+    constexpr Vec2i& operator /= (int value)
+    {
+        x /= value;
+        y /= value;
+        return *this;
+    }
+};
+
+static_assert(std::is_trivially_copyable<Vec2i>::value, "Vec2i must stay trivially copyable");
+
+constexpr Vec2i operator + (const Vec2i& v1, const Vec2i& v2)
+{
+    return {v1.x + v2.x, v1.y + v2.y};
+}
+
+constexpr Vec2i operator - (const Vec2i& v1, const Vec2i& v2)
+{
+    return {v1.x - v2.x, v1.y - v2.y};
+}
+
+constexpr Vec2i operator - (const Vec2i& v)
+{
+    return {-v.x, -v.y};
+}
+
+constexpr Vec2i operator * (const Vec2i& v, int value)
+{
+    return {v.x * value, v.y * value};
+}
+
+constexpr Vec2i operator * (int value, const Vec2i& v)
+{
+    return {v.x * value, v.y * value};
+}
+
+constexpr Vec2i operator / (const Vec2i& v, int value)
+{
+    return {v.x / value, v.y / value};
+}
+
+constexpr bool operator == (const Vec2i& v1, const Vec2i& v2)
+{
+    return v1.x == v2.x && v1.y == v2.y;
+}
+
+constexpr bool operator != (const Vec2i& v1, const Vec2i& v2)
+{
+    return !(v1 == v2);
+}
+
+namespace std
+{
+    template <>
+    struct hash<Vec2i>
+    {
+        std::size_t operator()(const Vec2i& v) const
+        {
+            return std::hash<std::uint64_t>()(std::uint64_t(std::uint32_t(v.x)) << 32 | std::uint32_t(v.y));
+        }
+    };
+}